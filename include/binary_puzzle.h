@@ -1,9 +1,25 @@
 #ifndef BINARY_PUZZLE_H
 #define BINARY_PUZZLE_H
 
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
+/*
+ * Symmetries of a board: bit 0 transposes it, bit 1 reverses its rows, bit 2
+ * reverses its columns and bit 3 swaps zeros and ones. Each preserves the
+ * rules, so a puzzle's variants are as valid, unique and hard as it is.
+ */
+#define BINARY_PUZZLE_SYMMETRY_COUNT 16
+
+/* bytes in the canonical form of a board of side `size` */
+#define BINARY_PUZZLE_CANONICAL_BYTES(size)                                    \
+    (2 * (((size_t)(size) * (size) + 7) / 8))
+
 typedef struct BinaryPuzzle BinaryPuzzle;
+typedef struct BinaryPuzzleTrace BinaryPuzzleTrace;
+typedef struct BinaryPuzzleSet BinaryPuzzleSet;
+typedef struct BinaryPuzzleCancel BinaryPuzzleCancel;
 
 typedef enum {
     BINARY_PUZZLE_EASY,
@@ -11,18 +27,309 @@ typedef enum {
     BINARY_PUZZLE_HARD
 } binary_puzzle_difficulty_t;
 
+typedef enum {
+    BINARY_PUZZLE_OK,
+    BINARY_PUZZLE_ERR_INVALID_ARGUMENT,
+    BINARY_PUZZLE_ERR_NO_MEMORY,
+    BINARY_PUZZLE_ERR_UNSOLVABLE,
+    BINARY_PUZZLE_ERR_OUT_OF_GUESSES,
+    BINARY_PUZZLE_ERR_IO,
+    BINARY_PUZZLE_ERR_CANCELLED,
+    BINARY_PUZZLE_ERR_EXHAUSTED,
+    BINARY_PUZZLE_ERR_TIMED_OUT,
+    /* a valid puzzle was made, but time ran out before every cell was hidden */
+    BINARY_PUZZLE_TRUNCATED
+} binary_puzzle_status_t;
+
+typedef enum {
+    /* search for a solution until one is found */
+    BINARY_PUZZLE_RESTART_NONE,
+    /* cutoffs of `restart_base` times 1, 1, 2, 1, 1, 2, 4, 1, ... */
+    BINARY_PUZZLE_RESTART_LUBY,
+    /* cutoffs of `restart_base` growing by half each restart */
+    BINARY_PUZZLE_RESTART_GEOMETRIC
+} binary_puzzle_restart_t;
+
+typedef enum {
+    /* try hiding one cell at a time */
+    BINARY_PUZZLE_MASK_SINGLE,
+    /*
+     * try hiding batches of cells with one solve, bisecting failed batches,
+     * while most cells tested can be hidden
+     */
+    BINARY_PUZZLE_MASK_BULK,
+    /*
+     * hide only cells the rules settle outright, with no solves: at most as
+     * hard as the difficulty asks and far faster, for `binary_puzzle_harden`
+     * to continue from
+     */
+    BINARY_PUZZLE_MASK_RULES
+} binary_puzzle_mask_t;
+
+typedef struct {
+    /* even number greater than 0 */
+    uint8_t size;
+    binary_puzzle_difficulty_t difficulty;
+    /* same seed and options always produce the same puzzle */
+    uint32_t seed;
+
+    /*
+     * Abandon a solution search after a number of contradictions given by
+     * `restart_schedule` and start over with a seed derived from `seed`, so
+     * an unlucky early guess cannot cause unbounded backtracking.
+     */
+    binary_puzzle_restart_t restart_schedule;
+    uint32_t restart_base;
+
+    /*
+     * How cells are tested for hiding. Sizes with a specialized kernel test
+     * one cell at a time unless this is `BINARY_PUZZLE_MASK_RULES`.
+     */
+    binary_puzzle_mask_t mask_strategy;
+
+    /*
+     * Searches to race on their own threads, each from its own seed, keeping
+     * whichever puzzle is finished first and cancelling the rest. Cuts the
+     * heavy tail of generation time on large boards at the cost of the same
+     * seed always producing the same puzzle. 0 or 1 generates on the calling
+     * thread.
+     */
+    uint8_t portfolio_threads;
+
+    /*
+     * Threads sharing each propagation round of the solution search and
+     * masking, for boards without a specialized kernel. Pays off on boards
+     * of about 200 and up. Every cell of a round is deduced from the board
+     * as it stood when the round began, and the deductions are merged in
+     * row-major order, so a seed gives the same puzzle on any number of
+     * threads. 0 or 1 propagates on the calling thread.
+     */
+    uint8_t propagation_threads;
+
+    /*
+     * Fill batches with the symmetric variants of fewer generated puzzles,
+     * up to `BINARY_PUZZLE_SYMMETRY_COUNT` per generation.
+     */
+    bool batch_variants;
+
+    /*
+     * Search for only the first solution of a batch and walk each later one
+     * from the one before by this many random moves that keep every rule,
+     * such as flipping the corners of a rectangle of alternating cells or
+     * swapping two rows. More moves make consecutive puzzles less alike. 0
+     * searches for every solution.
+     */
+    uint32_t batch_mixing_moves;
+
+    /*
+     * Puzzles already handed out, `NULL` for none. Batch generation replaces
+     * puzzles equal to one in the set up to symmetry and adds the rest, so
+     * one set shared by many batches keeps them all distinct.
+     */
+    BinaryPuzzleSet *dedup;
+
+    /*
+     * Milliseconds `binary_puzzle_generate` and `binary_puzzle_harden` may
+     * take, 0 for no limit. Running out while hiding cells keeps the cells
+     * hidden so far and returns `BINARY_PUZZLE_TRUNCATED`; running out before
+     * that returns `BINARY_PUZZLE_ERR_TIMED_OUT`.
+     */
+    uint32_t time_budget_ms;
+
+    /*
+     * Stops `binary_puzzle_generate` and `binary_puzzle_harden` with
+     * `BINARY_PUZZLE_ERR_CANCELLED` soon after it is requested, `NULL` if
+     * they cannot be cancelled.
+     */
+    const BinaryPuzzleCancel *cancel;
+
+    /*
+     * Where to record generation events, `NULL` for nowhere. Only libraries
+     * built with `BINARY_PUZZLE_TRACE` defined record anything, and batch and
+     * portfolio generation never do.
+     */
+    BinaryPuzzleTrace *trace;
+} binary_puzzle_options_t;
+
+typedef struct {
+    /* times the solution search started over */
+    uint32_t restarts;
+    /* contradictions reached while searching for the solution */
+    uint32_t conflicts;
+    /* solver runs spent deciding which cells to hide */
+    uint32_t mask_solves;
+    /*
+     * wall-clock microseconds spent finding the solution (0 when it was found
+     * as part of a batch) and hiding cells
+     */
+    uint32_t solution_us;
+    uint32_t mask_us;
+} binary_puzzle_stats_t;
+
+typedef enum {
+    /* the rules filled in cell (i, j) with `value` */
+    BINARY_PUZZLE_EVENT_ASSIGN,
+    /* the solution search guessed `value` for cell (i, j) */
+    BINARY_PUZZLE_EVENT_GUESS,
+    /*
+     * the guess at cell (i, j) was refuted, so every cell filled in since is
+     * cleared and the cell becomes `value`
+     */
+    BINARY_PUZZLE_EVENT_BACKTRACK,
+    /* the solution search started over on an empty board */
+    BINARY_PUZZLE_EVENT_RESTART,
+    /* cell (i, j) was hidden */
+    BINARY_PUZZLE_EVENT_MASK_ACCEPT,
+    /* cell (i, j) has to stay shown */
+    BINARY_PUZZLE_EVENT_MASK_REJECT
+} binary_puzzle_event_kind_t;
+
+typedef struct {
+    /* microseconds since the trace was created */
+    uint64_t time_us;
+    /* a `binary_puzzle_event_kind_t` */
+    uint8_t kind;
+    uint8_t i;
+    uint8_t j;
+    uint8_t value;
+} binary_puzzle_event_t;
+
+/**
+ * Fill `options` with defaults for a puzzle of the given size and difficulty.
+ */
+void binary_puzzle_options_init(binary_puzzle_options_t *options, uint8_t size,
+                                binary_puzzle_difficulty_t difficulty);
+
+/**
+ * Return a human readable description of `status`.
+ */
+const char *binary_puzzle_status_string(binary_puzzle_status_t status);
+
+/**
+ * Generate a new `BinaryPuzzle` into `out`.
+ *
+ * Reentrant: all state lives in the puzzle being generated.
+ * `out` is set to `NULL` unless `BINARY_PUZZLE_OK` or `BINARY_PUZZLE_TRUNCATED`
+ * is returned.
+ */
+binary_puzzle_status_t
+binary_puzzle_generate(const binary_puzzle_options_t *options,
+                       BinaryPuzzle **out);
+
+/**
+ * Generate `count` puzzles of the same size into `out`.
+ *
+ * Solutions for sizes up to 32 are searched for many puzzles at once with the
+ * widest vector instructions the CPU supports. Generated puzzle `k` is seeded
+ * with `options->seed + k` and, with `batch_variants`, followed by its
+ * variants. On failure every entry of `out` is `NULL`.
+ */
+binary_puzzle_status_t
+binary_puzzle_generate_batch(const binary_puzzle_options_t *options,
+                             BinaryPuzzle **out, size_t count);
+
+/**
+ * Create a `BinaryPuzzle` from `size * size` row-major cells, where `'0'` and
+ * `'1'` are given values and any other character is hidden.
+ *
+ * The hidden cells are unknown until `binary_puzzle_solve` succeeds.
+ */
+binary_puzzle_status_t binary_puzzle_parse(uint8_t size, const char *cells,
+                                           BinaryPuzzle **out);
+
+/**
+ * Create into `out` a copy of `self` that also hides every further cell
+ * `options->difficulty` allows, testing them as `options->mask_strategy` says.
+ * `options->size` must match `self`.
+ *
+ * `out` is set to `NULL` unless `BINARY_PUZZLE_OK` or `BINARY_PUZZLE_TRUNCATED`
+ * is returned.
+ */
+binary_puzzle_status_t
+binary_puzzle_harden(const BinaryPuzzle *self,
+                     const binary_puzzle_options_t *options,
+                     BinaryPuzzle **out);
+
+/**
+ * Fill in the hidden cells of `self`, making at most `allowed_guesses` nested
+ * guesses (`UINT16_MAX` for no limit). Given cells that break a rule make
+ * `self` unsolvable.
+ */
+binary_puzzle_status_t binary_puzzle_solve(BinaryPuzzle *self,
+                                           uint16_t allowed_guesses);
+
+/**
+ * Set `unique` to whether the solution `binary_puzzle_solve` found for `self`
+ * is the only one its given cells allow. Searching for another solution adds
+ * to the conflicts in its stats.
+ */
+binary_puzzle_status_t binary_puzzle_check_unique(BinaryPuzzle *self,
+                                                  bool *unique);
+
+/**
+ * Write the `size * size` row-major cells of `self` and a null terminator into
+ * `out`, in the format read by `binary_puzzle_parse`. Hidden cells are written
+ * as `'.'` unless `reveal` is set.
+ */
+void binary_puzzle_write_cells(const BinaryPuzzle *self, bool reveal,
+                               char *out);
+
+/**
+ * Create into `out` the puzzle `self` becomes under `symmetry`, below
+ * `BINARY_PUZZLE_SYMMETRY_COUNT`, with the solution and hidden cells moved
+ * together.
+ */
+binary_puzzle_status_t binary_puzzle_transform(const BinaryPuzzle *self,
+                                               uint8_t symmetry,
+                                               BinaryPuzzle **out);
+
+/**
+ * Create the distinct puzzles `self` becomes under every symmetry, a copy of
+ * `self` first, into `out`, which has room for `BINARY_PUZZLE_SYMMETRY_COUNT`.
+ * Set `count` to how many were created.
+ */
+binary_puzzle_status_t binary_puzzle_variants(const BinaryPuzzle *self,
+                                              BinaryPuzzle **out,
+                                              size_t *count);
+
+/**
+ * Write the canonical form of `self` into `out`, which has room for
+ * `BINARY_PUZZLE_CANONICAL_BYTES(size)` bytes: the smallest, over every
+ * symmetry, of the solution's cells packed into bits followed by the mask's.
+ * Puzzles have the same canonical form iff one is a variant of the other.
+ */
+void binary_puzzle_write_canonical(const BinaryPuzzle *self, uint8_t *out);
+
+/**
+ * Return a 64-bit FNV-1a hash of the canonical form of `self`.
+ */
+uint64_t binary_puzzle_canonical_hash(const BinaryPuzzle *self);
+
+/**
+ * Fill `stats` with how much work generating `self` took.
+ */
+void binary_puzzle_get_stats(const BinaryPuzzle *self,
+                             binary_puzzle_stats_t *stats);
+
 /**
- * Enter interactive solver.
+ * Return the side length of `self`.
  */
-void binary_puzzle_interactive(BinaryPuzzle *self);
+uint8_t binary_puzzle_get_size(const BinaryPuzzle *self);
 
 /**
- * Print contents of `BinaryPuzzle`.
+ * Return the value of the solution at row `i`, column `j`.
  */
-void binary_puzzle_print(BinaryPuzzle *self);
+bool binary_puzzle_get_solution(const BinaryPuzzle *self, uint8_t i,
+                                uint8_t j);
 
 /**
- * Create a new `BinaryPuzzle` object.
+ * Return `true` iff the cell at row `i`, column `j` is shown to the player.
+ */
+bool binary_puzzle_is_given(const BinaryPuzzle *self, uint8_t i, uint8_t j);
+
+/**
+ * Create a new `BinaryPuzzle` object, seeded from `rand`. Boards of 40 and up
+ * race a search per CPU, as with `portfolio_threads`.
  *
  * Return `NULL` on failure
  */
@@ -33,4 +340,102 @@ BinaryPuzzle *binary_puzzle_create(uint8_t size, binary_puzzle_difficulty_t diff
  */
 void binary_puzzle_destroy(BinaryPuzzle *self);
 
+/**
+ * Create a cancellation token for `binary_puzzle_options_t`, not yet
+ * requested.
+ *
+ * Return `NULL` on failure.
+ */
+BinaryPuzzleCancel *binary_puzzle_cancel_create(void);
+
+/**
+ * Ask every generation using `self` to stop. Safe to call from any thread,
+ * any number of times.
+ */
+void binary_puzzle_cancel_request(BinaryPuzzleCancel *self);
+
+/**
+ * Destroy the `BinaryPuzzleCancel`, once no generation uses it.
+ */
+void binary_puzzle_cancel_destroy(BinaryPuzzleCancel *self);
+
+/**
+ * Create a set of puzzles up to symmetry, safe to share between threads,
+ * remembering at least `capacity` puzzles in about 16 bytes each. Once more
+ * are added, new ones overwrite old ones, so memory stays bounded on endless
+ * runs.
+ *
+ * Puzzles are told apart by a 64-bit hash of their canonical form, so a new
+ * puzzle is taken for a duplicate with a chance of about one in 2^64 per
+ * puzzle held.
+ *
+ * Return `NULL` on failure.
+ */
+BinaryPuzzleSet *binary_puzzle_set_create(size_t capacity);
+
+/**
+ * Add `puzzle` to `self`.
+ *
+ * Return `true` iff no variant of it was in `self` already.
+ */
+bool binary_puzzle_set_insert(BinaryPuzzleSet *self, const BinaryPuzzle *puzzle);
+
+/**
+ * Return how many puzzles have been added to `self`, forgotten ones included.
+ */
+size_t binary_puzzle_set_get_count(const BinaryPuzzleSet *self);
+
+/**
+ * Destroy the `BinaryPuzzleSet`.
+ */
+void binary_puzzle_set_destroy(BinaryPuzzleSet *self);
+
+/**
+ * Create a trace keeping the last `capacity` events recorded into it.
+ *
+ * Return `NULL` on failure.
+ */
+BinaryPuzzleTrace *binary_puzzle_trace_create(size_t capacity);
+
+/**
+ * Write `self` to the file at `path`, to be read by `binary_puzzle_trace_load`.
+ */
+binary_puzzle_status_t binary_puzzle_trace_save(const BinaryPuzzleTrace *self,
+                                                const char *path);
+
+/**
+ * Read a trace written by `binary_puzzle_trace_save` into `out`.
+ *
+ * `out` is set to `NULL` unless `BINARY_PUZZLE_OK` is returned.
+ */
+binary_puzzle_status_t binary_puzzle_trace_load(const char *path,
+                                                BinaryPuzzleTrace **out);
+
+/**
+ * Return the side length of the last board recorded into `self`, or 0 if
+ * there is none.
+ */
+uint8_t binary_puzzle_trace_get_size(const BinaryPuzzleTrace *self);
+
+/**
+ * Return how many events `self` holds.
+ */
+size_t binary_puzzle_trace_get_event_count(const BinaryPuzzleTrace *self);
+
+/**
+ * Return how many of the oldest events were overwritten for lack of room.
+ */
+size_t binary_puzzle_trace_get_dropped_count(const BinaryPuzzleTrace *self);
+
+/**
+ * Return event `k` of `self`, counting from the oldest one held.
+ */
+binary_puzzle_event_t
+binary_puzzle_trace_get_event(const BinaryPuzzleTrace *self, size_t k);
+
+/**
+ * Destroy the `BinaryPuzzleTrace`.
+ */
+void binary_puzzle_trace_destroy(BinaryPuzzleTrace *self);
+
 #endif
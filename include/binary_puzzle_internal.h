@@ -0,0 +1,209 @@
+#ifndef BINARY_PUZZLE_INTERNAL_H
+#define BINARY_PUZZLE_INTERNAL_H
+
+/*
+ * Shared between the library's translation units; not installed alongside
+ * `binary_puzzle.h`.
+ */
+
+#include "binary_puzzle.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef enum {
+    SOLVE_SUCCESS,
+    SOLVE_OUT_OF_GUESSES,
+    SOLVE_REACHED_INVALID,
+    SOLVE_SYSTEM_ERROR,
+    /* gave up after `conflict_limit` conflicts */
+    SOLVE_RESTART,
+    /* gave up because `cancelled` was set */
+    SOLVE_CANCELLED
+} solve_status_t;
+
+/* State threaded through a search. */
+typedef struct {
+    uint32_t rng_state;
+    /* times propagation reached a contradiction */
+    uint32_t conflict_ct;
+    /* give up with `SOLVE_RESTART` at this many conflicts, 0 for never */
+    uint32_t conflict_limit;
+    /* searches started while masking */
+    uint32_t search_ct;
+    /* where to record the steps of the search, `NULL` for nowhere */
+    BinaryPuzzleTrace *trace;
+    /* set nonzero by another thread to stop the search, `NULL` if none can */
+    const int *cancelled;
+    /* the caller's token, stopping the search the same way */
+    const BinaryPuzzleCancel *cancel;
+    /* `CLOCK_MONOTONIC` microseconds to stop the search at, 0 for never */
+    uint64_t deadline_us;
+    /* set once the search stopped because `deadline_us` passed */
+    bool timed_out;
+} SearchContext;
+
+/*
+ * Record an event into `trace` if it is not `NULL`. Without
+ * `BINARY_PUZZLE_TRACE` this expands to nothing, so recording costs nothing
+ * in normal builds.
+ */
+#ifdef BINARY_PUZZLE_TRACE
+#define TRACE_EVENT(trace, kind, i, j, value)                                  \
+    do {                                                                       \
+        if ((trace) != NULL)                                                   \
+            binary_puzzle_trace_record((trace), (kind), (i), (j), (value));    \
+    } while (0)
+#else
+#define TRACE_EVENT(trace, kind, i, j, value) ((void)(trace))
+#endif
+
+/**
+ * Append an event to `self`, overwriting the oldest one if it is full.
+ */
+void binary_puzzle_trace_record(BinaryPuzzleTrace *self,
+                                binary_puzzle_event_kind_t kind, size_t i,
+                                size_t j, bool value);
+
+/**
+ * Note that the events that follow in `self` are about a board of side
+ * `size`.
+ */
+void binary_puzzle_trace_begin(BinaryPuzzleTrace *self, uint8_t size);
+
+/*
+ * Solver and masker specialized for one board size. Boards are row-major
+ * `size * size` arrays.
+ */
+typedef struct {
+    uint8_t size;
+    /**
+     * Fill the cells of `solution` not set in `initialized`, making at most
+     * `allowed_guesses` nested guesses (`UINT16_MAX` for no limit).
+     */
+    solve_status_t (*solve)(bool *solution, const bool *initialized,
+                            uint16_t allowed_guesses, SearchContext *context);
+    /**
+     * Clear every entry of `mask` that can be hidden within
+     * `allowed_guesses` nested guesses.
+     */
+    void (*initialize_mask)(const bool *solution, bool *mask,
+                            uint16_t allowed_guesses, SearchContext *context);
+} BinaryPuzzleKernel;
+
+/**
+ * Count a contradiction reached by the search using `context`.
+ *
+ * Return `SOLVE_CANCELLED` if the search was cancelled, `SOLVE_RESTART` once
+ * the conflict limit is reached, else `SOLVE_REACHED_INVALID`.
+ */
+solve_status_t binary_puzzle_search_conflict(SearchContext *context);
+
+/**
+ * Return `true` iff the search using `context` has been cancelled or has run
+ * past its deadline.
+ */
+bool binary_puzzle_search_cancelled(SearchContext *context);
+
+/**
+ * Return the kernel specialized for `size`, or `NULL` if there is none.
+ */
+const BinaryPuzzleKernel *binary_puzzle_kernel_find(uint8_t size);
+
+/**
+ * Return a nonzero generator state derived from `seed`.
+ */
+uint32_t binary_puzzle_rng_seed(uint32_t seed);
+
+/**
+ * Advance `state` and return a pseudo-random number in [0, 1).
+ */
+double binary_puzzle_rng_next(uint32_t *state);
+
+/**
+ * Return the conflict limit for attempt `restart_ct` of a solution search
+ * under `options`, or 0 for no limit.
+ */
+uint32_t binary_puzzle_restart_cutoff(const binary_puzzle_options_t *options,
+                                      uint32_t restart_ct);
+
+/**
+ * Return the seed for attempt `restart_ct` of a search started from `seed`.
+ */
+uint32_t binary_puzzle_restart_seed(uint32_t seed, uint32_t restart_ct);
+
+/**
+ * Apply `move_ct` random moves that keep every rule to the complete
+ * `size * size` row-major `solution`, drawing from `rng_state`.
+ */
+binary_puzzle_status_t binary_puzzle_mix_solution(bool *solution, uint8_t size,
+                                                  uint32_t move_ct,
+                                                  uint32_t *rng_state);
+
+/**
+ * Create a `BinaryPuzzle` from a complete `size * size` row-major `solution`
+ * and hide cells as `options` asks. `stats` describes how the solution was
+ * found.
+ */
+binary_puzzle_status_t
+binary_puzzle_mask_solution(const binary_puzzle_options_t *options,
+                            const bool *solution,
+                            const binary_puzzle_stats_t *stats,
+                            BinaryPuzzle **out);
+
+/**
+ * Generate a new `BinaryPuzzle` into `out` on the calling thread, giving up
+ * with `BINARY_PUZZLE_ERR_CANCELLED` soon after `*cancelled` becomes nonzero.
+ * `cancelled` may be `NULL`; `options->portfolio_threads` is ignored.
+ */
+binary_puzzle_status_t
+binary_puzzle_generate_cancellable(const binary_puzzle_options_t *options,
+                                   const int *cancelled, BinaryPuzzle **out);
+
+/**
+ * Generate a new `BinaryPuzzle` into `out` by racing
+ * `options->portfolio_threads` searches.
+ */
+binary_puzzle_status_t
+binary_puzzle_generate_portfolio(const binary_puzzle_options_t *options,
+                                 BinaryPuzzle **out);
+
+/**
+ * Return how many searches a portfolio should race on this machine.
+ */
+uint8_t binary_puzzle_portfolio_default_threads(void);
+
+/* Threads kept waiting to run one job at a time between them. */
+typedef struct BinaryPuzzlePool BinaryPuzzlePool;
+
+/**
+ * Part `part` of `thread_ct` parts of a job run by `binary_puzzle_pool_run`.
+ */
+typedef void (*binary_puzzle_pool_job_fn)(void *arg, size_t part,
+                                          size_t thread_ct);
+
+/**
+ * Start a pool of `thread_ct` threads, the caller of `binary_puzzle_pool_run`
+ * being one of them.
+ *
+ * Return `NULL` on failure.
+ */
+BinaryPuzzlePool *binary_puzzle_pool_create(uint8_t thread_ct);
+
+/**
+ * Return how many threads, the caller included, run each job of `self`.
+ */
+size_t binary_puzzle_pool_get_threads(const BinaryPuzzlePool *self);
+
+/**
+ * Run every part of `job` on the threads of `self`, part 0 on the calling
+ * thread, and return once all of them have.
+ */
+void binary_puzzle_pool_run(BinaryPuzzlePool *self,
+                            binary_puzzle_pool_job_fn job, void *arg);
+
+/**
+ * Stop the threads of `self` and destroy it. `NULL` is ignored.
+ */
+void binary_puzzle_pool_destroy(BinaryPuzzlePool *self);
+
+#endif
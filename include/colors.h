@@ -16,6 +16,8 @@
 #define HIDE_CURSOR "\033[?25l"
 #define SHOW_CURSOR "\033[?25h"
 
+#define REVERSE "\033[7m"
+
 #define RESET "\033[0m"
 
 #endif
@@ -0,0 +1,55 @@
+#ifndef LATENCY_LOG_H
+#define LATENCY_LOG_H
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Timings of the frames drawn by the interactive solver and of the keys
+ * they answer, kept as histograms of power-of-two microsecond buckets.
+ */
+typedef struct LatencyLog LatencyLog;
+
+/**
+ * Create an empty `LatencyLog`.
+ *
+ * Return `NULL` on failure.
+ */
+LatencyLog *latency_log_create(void);
+
+/**
+ * Note that a key was just read. The next frame written answers it, along
+ * with any other key read before then, and is timed from the earliest.
+ */
+void latency_log_key(LatencyLog *self);
+
+/**
+ * Note that building a frame just began.
+ */
+void latency_log_frame_start(LatencyLog *self);
+
+/**
+ * Note that the frame begun last is built and about to be written.
+ */
+void latency_log_frame_built(LatencyLog *self);
+
+/**
+ * Note that the frame begun last was written in full: `byte_ct` bytes, taking
+ * `syscall_ct` system calls from start to finish.
+ */
+void latency_log_frame_written(LatencyLog *self, size_t byte_ct,
+                               uint32_t syscall_ct);
+
+/**
+ * Write the totals and histograms of `self` as text to the file at `path`.
+ *
+ * Return `true` iff successful.
+ */
+bool latency_log_save(const LatencyLog *self, const char *path);
+
+/**
+ * Destroy the `LatencyLog`.
+ */
+void latency_log_destroy(LatencyLog *self);
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef TUI_H
+#define TUI_H
+
+#include "binary_puzzle.h"
+#include <stdbool.h>
+
+/**
+ * Enter interactive solver.
+ *
+ * Unless `harder` is `NULL`, more cells of `self` are hidden in the
+ * background as `harder` allows. The result replaces `self` if no cell has
+ * been set yet, and is otherwise offered to switch to.
+ *
+ * Unless `latency_path` is `NULL`, every key read and frame written is timed,
+ * and the histograms are written to the file at `latency_path` on exit.
+ *
+ * Return `false` if the terminal could not be used.
+ */
+bool binary_puzzle_interactive(const BinaryPuzzle *self,
+                               const binary_puzzle_options_t *harder,
+                               const char *latency_path);
+
+/**
+ * Print contents of `BinaryPuzzle`.
+ */
+void binary_puzzle_print(const BinaryPuzzle *self);
+
+#endif
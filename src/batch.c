@@ -0,0 +1,600 @@
+#include "binary_puzzle.h"
+#include "binary_puzzle_internal.h"
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* boards searched side by side; one AVX-512 register of 32-bit lanes */
+#define BATCH_LANES 16
+/* rows are 32-bit lane words */
+#define BATCH_MAX_SIZE 32
+/* enough bits to count up to BATCH_MAX_SIZE */
+#define BATCH_COUNT_BITS 6
+/* seeds tried for one puzzle before concluding every new one is taken */
+#define DEDUP_MAX_ATTEMPTS 1024
+
+/*
+ * Structure-of-arrays boards: `ones[r][lane]` holds the known ones of row `r`
+ * of the board in `lane`, so one vector load covers the same row of
+ * consecutive boards.
+ */
+typedef struct {
+    uint32_t ones[BATCH_MAX_SIZE][BATCH_LANES];
+    uint32_t zeros[BATCH_MAX_SIZE][BATCH_LANES];
+} BatchBoards;
+
+typedef void (*batch_propagate_fn)(BatchBoards *boards, uint8_t size,
+                                   uint32_t *changed, uint32_t *conflict);
+
+#define KERNEL_NAME batch_propagate_scalar
+#define KERNEL_TARGET
+#define KERNEL_WORD uint32_t
+#define KERNEL_LANES 1
+#define KERNEL_MASK(x) ((uint32_t)0 - (uint32_t)(x))
+#include "batch_kernel.h"
+#undef KERNEL_NAME
+#undef KERNEL_TARGET
+#undef KERNEL_WORD
+#undef KERNEL_LANES
+#undef KERNEL_MASK
+
+#if defined(__x86_64__) || defined(__i386__)
+typedef uint32_t batch_word_8 __attribute__((vector_size(32)));
+typedef uint32_t batch_word_16 __attribute__((vector_size(64)));
+
+#define KERNEL_NAME batch_propagate_avx2
+#define KERNEL_TARGET __attribute__((target("avx2")))
+#define KERNEL_WORD batch_word_8
+#define KERNEL_LANES 8
+#define KERNEL_MASK(x) ((batch_word_8)(x))
+#include "batch_kernel.h"
+#undef KERNEL_NAME
+#undef KERNEL_TARGET
+#undef KERNEL_WORD
+#undef KERNEL_LANES
+#undef KERNEL_MASK
+
+#define KERNEL_NAME batch_propagate_avx512
+#define KERNEL_TARGET __attribute__((target("avx512f")))
+#define KERNEL_WORD batch_word_16
+#define KERNEL_LANES 16
+#define KERNEL_MASK(x) ((batch_word_16)(x))
+#include "batch_kernel.h"
+#undef KERNEL_NAME
+#undef KERNEL_TARGET
+#undef KERNEL_WORD
+#undef KERNEL_LANES
+#undef KERNEL_MASK
+#endif
+
+/**
+ * Return the widest propagation kernel the running CPU supports.
+ */
+static batch_propagate_fn batch_select_kernel(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        return batch_propagate_avx512;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        return batch_propagate_avx2;
+    }
+#endif
+    return batch_propagate_scalar;
+}
+
+/* search state saved before a guess, restored when it is refuted */
+typedef struct {
+    uint8_t i;
+    uint8_t j;
+    bool value;
+    bool flipped;
+} BatchGuess;
+
+typedef struct {
+    bool active;
+    /* index into the output of the puzzle being searched */
+    size_t puzzle_idx;
+    /* seeds tried for it so far, all but the last giving duplicates */
+    uint32_t attempt_ct;
+    uint32_t seed;
+    uint32_t rng_state;
+    /* conflicts this attempt, and how many it may have before restarting */
+    uint32_t conflict_ct;
+    uint32_t conflict_limit;
+    binary_puzzle_stats_t stats;
+
+    size_t guess_ct;
+    BatchGuess *guesses;
+    /* `2 * size` words per guess: ones then zeros of every row */
+    uint32_t *snapshots;
+} BatchLane;
+
+typedef struct {
+    const binary_puzzle_options_t *options;
+    size_t count;
+    uint8_t size;
+    uint32_t full;
+    BatchBoards boards;
+    BatchLane lanes[BATCH_LANES];
+    uint32_t changed[BATCH_LANES];
+    uint32_t conflict[BATCH_LANES];
+    batch_propagate_fn propagate;
+} Batch;
+
+/**
+ * Clear the board in `lane` and start a new attempt at its puzzle.
+ */
+static void batch_lane_start(Batch *self, size_t lane) {
+    BatchLane *state = &self->lanes[lane];
+    size_t r;
+    for (r = 0; r < self->size; r++) {
+        self->boards.ones[r][lane] = 0;
+        self->boards.zeros[r][lane] = 0;
+    }
+    state->rng_state = binary_puzzle_rng_seed(
+        binary_puzzle_restart_seed(state->seed, state->stats.restarts));
+    state->conflict_ct = 0;
+    state->conflict_limit
+        = binary_puzzle_restart_cutoff(self->options, state->stats.restarts);
+    state->guess_ct = 0;
+}
+
+/**
+ * Return the seed of attempt `attempt_ct` at puzzle `puzzle_idx` of a batch of
+ * `count`. Later attempts only happen when earlier ones gave duplicates, and
+ * take seeds past the end of the batch.
+ */
+static uint32_t batch_seed(const binary_puzzle_options_t *options,
+                           size_t puzzle_idx, size_t count,
+                           uint32_t attempt_ct) {
+    return options->seed + puzzle_idx + attempt_ct * count;
+}
+
+static void batch_lane_reset(Batch *self, size_t lane, size_t puzzle_idx,
+                             uint32_t attempt_ct) {
+    BatchLane *state = &self->lanes[lane];
+    state->active = true;
+    state->puzzle_idx = puzzle_idx;
+    state->attempt_ct = attempt_ct;
+    state->seed = batch_seed(self->options, puzzle_idx, self->count, attempt_ct);
+    memset(&state->stats, 0, sizeof(binary_puzzle_stats_t));
+    batch_lane_start(self, lane);
+}
+
+/**
+ * Run propagation rounds until no active board changes.
+ */
+static void batch_propagate(Batch *self) {
+    size_t lane;
+    bool updated;
+    do {
+        self->propagate(&self->boards, self->size, self->changed,
+                        self->conflict);
+        updated = false;
+        for (lane = 0; lane < BATCH_LANES; lane++) {
+            if (self->lanes[lane].active && self->changed[lane]
+                && !self->conflict[lane]) {
+                updated = true;
+            }
+        }
+    } while (updated);
+}
+
+static bool batch_lane_is_complete(Batch *self, size_t lane) {
+    size_t r;
+    for (r = 0; r < self->size; r++) {
+        if ((self->boards.ones[r][lane] | self->boards.zeros[r][lane])
+            != self->full) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void batch_lane_assign(Batch *self, size_t lane, uint8_t i, uint8_t j,
+                              bool value) {
+    if (value) {
+        self->boards.ones[i][lane] |= (uint32_t)1 << j;
+    } else {
+        self->boards.zeros[i][lane] |= (uint32_t)1 << j;
+    }
+}
+
+static uint8_t popcount(uint32_t x) { return __builtin_popcount(x); }
+
+/**
+ * Guess the most one-sided unknown cell of the board in `lane`, with the same
+ * heuristic as `binary_puzzle_make_probable_guess`.
+ */
+static void batch_lane_guess(Batch *self, size_t lane) {
+    BatchLane *state = &self->lanes[lane];
+    uint8_t col_ones_needed[BATCH_MAX_SIZE], col_zeroes_needed[BATCH_MAX_SIZE];
+    uint8_t row_ones_needed, row_zeroes_needed;
+    uint16_t one_straws, zero_straws;
+    uint32_t ones, zeros, *snapshot;
+    float one_probability, dramaticity, best_one_probability = 0.5f,
+                                        best_dramaticity = 0;
+    uint8_t i, j, best_i = 0, best_j = 0;
+    bool contender_found = false, value;
+
+    for (j = 0; j < self->size; j++) {
+        col_ones_needed[j] = self->size / 2;
+        col_zeroes_needed[j] = self->size / 2;
+    }
+    for (i = 0; i < self->size; i++) {
+        ones = self->boards.ones[i][lane];
+        zeros = self->boards.zeros[i][lane];
+        for (j = 0; j < self->size; j++) {
+            col_ones_needed[j] -= ones >> j & 1;
+            col_zeroes_needed[j] -= zeros >> j & 1;
+        }
+    }
+
+    for (i = 0; i < self->size; i++) {
+        ones = self->boards.ones[i][lane];
+        zeros = self->boards.zeros[i][lane];
+        row_ones_needed = self->size / 2 - popcount(ones);
+        row_zeroes_needed = self->size / 2 - popcount(zeros);
+        for (j = 0; j < self->size; j++) {
+            if ((ones | zeros) >> j & 1) {
+                continue;
+            }
+            one_straws = row_ones_needed * col_ones_needed[j];
+            zero_straws = row_zeroes_needed * col_zeroes_needed[j];
+            one_probability = (1.0f * one_straws) / (one_straws + zero_straws);
+            dramaticity = one_probability < 0.5 ? 1 - one_probability
+                                                : one_probability;
+            if (!contender_found || dramaticity > best_dramaticity) {
+                contender_found = true;
+                best_one_probability = one_probability;
+                best_dramaticity = dramaticity;
+                best_i = i;
+                best_j = j;
+            }
+        }
+    }
+
+    value = binary_puzzle_rng_next(&state->rng_state) < best_one_probability;
+
+    snapshot = state->snapshots + state->guess_ct * 2 * self->size;
+    for (i = 0; i < self->size; i++) {
+        snapshot[i] = self->boards.ones[i][lane];
+        snapshot[self->size + i] = self->boards.zeros[i][lane];
+    }
+    state->guesses[state->guess_ct].i = best_i;
+    state->guesses[state->guess_ct].j = best_j;
+    state->guesses[state->guess_ct].value = value;
+    state->guesses[state->guess_ct].flipped = false;
+    state->guess_ct++;
+
+    batch_lane_assign(self, lane, best_i, best_j, value);
+}
+
+/**
+ * Undo guesses on the board in `lane` up to the latest one whose other value
+ * is untried, and try that value. Start over instead once the restart
+ * schedule's conflict limit is reached.
+ *
+ * Return `false` if every guess has been refuted.
+ */
+static bool batch_lane_backtrack(Batch *self, size_t lane) {
+    BatchLane *state = &self->lanes[lane];
+    BatchGuess *guess;
+    uint32_t *snapshot;
+    uint8_t i;
+
+    state->stats.conflicts++;
+    state->conflict_ct++;
+    if (state->conflict_limit != 0
+        && state->conflict_ct >= state->conflict_limit) {
+        state->stats.restarts++;
+        batch_lane_start(self, lane);
+        return true;
+    }
+
+    while (state->guess_ct > 0) {
+        guess = &state->guesses[state->guess_ct - 1];
+        snapshot = state->snapshots + (state->guess_ct - 1) * 2 * self->size;
+        for (i = 0; i < self->size; i++) {
+            self->boards.ones[i][lane] = snapshot[i];
+            self->boards.zeros[i][lane] = snapshot[self->size + i];
+        }
+        if (!guess->flipped) {
+            guess->flipped = true;
+            guess->value = !guess->value;
+            batch_lane_assign(self, lane, guess->i, guess->j, guess->value);
+            return true;
+        }
+        state->guess_ct--;
+    }
+    return false;
+}
+
+/**
+ * Mask the solved board in `lane` into `out[puzzle_idx]`.
+ */
+static binary_puzzle_status_t batch_lane_emit(Batch *self, size_t lane,
+                                              BinaryPuzzle **out,
+                                              bool *solution) {
+    binary_puzzle_options_t puzzle_options = *self->options;
+    size_t puzzle_idx = self->lanes[lane].puzzle_idx;
+    uint8_t i, j;
+
+    for (i = 0; i < self->size; i++) {
+        for (j = 0; j < self->size; j++) {
+            solution[i * self->size + j] = self->boards.ones[i][lane] >> j & 1;
+        }
+    }
+    puzzle_options.seed = self->lanes[lane].seed;
+    return binary_puzzle_mask_solution(&puzzle_options, solution,
+                                       &self->lanes[lane].stats,
+                                       &out[puzzle_idx]);
+}
+
+/**
+ * Add the puzzle just emitted by `lane` to the dedup set, if any, destroying
+ * it if it was there already.
+ *
+ * Return `true` iff the puzzle was kept.
+ */
+static bool batch_lane_keep(Batch *self, size_t lane, BinaryPuzzle **out) {
+    BinaryPuzzle **puzzle = &out[self->lanes[lane].puzzle_idx];
+    if (self->options->dedup == NULL
+        || binary_puzzle_set_insert(self->options->dedup, *puzzle)) {
+        return true;
+    }
+    binary_puzzle_destroy(*puzzle);
+    *puzzle = NULL;
+    return false;
+}
+
+static binary_puzzle_status_t batch_generate(Batch *self, BinaryPuzzle **out,
+                                             size_t count) {
+    binary_puzzle_status_t status;
+    size_t lane, next_puzzle = 0, done_ct = 0;
+    bool *solution = malloc((size_t)self->size * self->size * sizeof(bool));
+    if (solution == NULL) {
+        return BINARY_PUZZLE_ERR_NO_MEMORY;
+    }
+
+    for (lane = 0; lane < BATCH_LANES; lane++) {
+        if (next_puzzle < count) {
+            batch_lane_reset(self, lane, next_puzzle, 0);
+            next_puzzle++;
+        } else {
+            self->lanes[lane].active = false;
+        }
+    }
+
+    while (done_ct < count) {
+        batch_propagate(self);
+        for (lane = 0; lane < BATCH_LANES; lane++) {
+            if (!self->lanes[lane].active) {
+                continue;
+            }
+            if (self->conflict[lane]) {
+                if (!batch_lane_backtrack(self, lane)) {
+                    free(solution);
+                    return BINARY_PUZZLE_ERR_UNSOLVABLE;
+                }
+            } else if (batch_lane_is_complete(self, lane)) {
+                status = batch_lane_emit(self, lane, out, solution);
+                if (status != BINARY_PUZZLE_OK) {
+                    free(solution);
+                    return status;
+                }
+                if (!batch_lane_keep(self, lane, out)) {
+                    if (self->lanes[lane].attempt_ct + 1 == DEDUP_MAX_ATTEMPTS) {
+                        free(solution);
+                        return BINARY_PUZZLE_ERR_EXHAUSTED;
+                    }
+                    batch_lane_reset(self, lane, self->lanes[lane].puzzle_idx,
+                                     self->lanes[lane].attempt_ct + 1);
+                    continue;
+                }
+                done_ct++;
+                if (next_puzzle < count) {
+                    batch_lane_reset(self, lane, next_puzzle, 0);
+                    next_puzzle++;
+                } else {
+                    self->lanes[lane].active = false;
+                }
+            } else {
+                batch_lane_guess(self, lane);
+            }
+        }
+    }
+
+    free(solution);
+    return BINARY_PUZZLE_OK;
+}
+
+/**
+ * Fill `out` with the variants of as few puzzles generated by `options` as it
+ * takes, in turn.
+ */
+static binary_puzzle_status_t
+batch_generate_variants(const binary_puzzle_options_t *options,
+                        BinaryPuzzle **out, size_t count) {
+    binary_puzzle_options_t base_options = *options;
+    binary_puzzle_status_t status = BINARY_PUZZLE_OK;
+    BinaryPuzzle *variants[BINARY_PUZZLE_SYMMETRY_COUNT];
+    BinaryPuzzle **bases;
+    size_t filled_ct = 0, base_ct, variant_ct, k, v;
+
+    base_options.batch_variants = false;
+    while (filled_ct < count && status == BINARY_PUZZLE_OK) {
+        /* symmetric puzzles have fewer variants, so this may take rounds */
+        base_ct = (count - filled_ct + BINARY_PUZZLE_SYMMETRY_COUNT - 1)
+                  / BINARY_PUZZLE_SYMMETRY_COUNT;
+        bases = malloc(base_ct * sizeof(BinaryPuzzle *));
+        if (bases == NULL)
+            return BINARY_PUZZLE_ERR_NO_MEMORY;
+        status = binary_puzzle_generate_batch(&base_options, bases, base_ct);
+        base_options.seed += base_ct;
+
+        for (k = 0; k < base_ct && status == BINARY_PUZZLE_OK; k++) {
+            status = binary_puzzle_variants(bases[k], variants, &variant_ct);
+            for (v = 0; v < variant_ct; v++) {
+                if (filled_ct < count) {
+                    out[filled_ct++] = variants[v];
+                } else {
+                    binary_puzzle_destroy(variants[v]);
+                }
+            }
+        }
+        /* every variant is a copy, and failed batches leave `NULL` */
+        for (k = 0; k < base_ct; k++) {
+            binary_puzzle_destroy(bases[k]);
+        }
+        free(bases);
+    }
+    return status;
+}
+
+/**
+ * Fill `out` with puzzles whose solutions are each
+ * `options->batch_mixing_moves` moves on from the one before, searching only
+ * for the first.
+ */
+static binary_puzzle_status_t
+batch_generate_mixed(const binary_puzzle_options_t *options,
+                     BinaryPuzzle **out, size_t count) {
+    binary_puzzle_options_t puzzle_options = *options;
+    binary_puzzle_status_t status = BINARY_PUZZLE_OK;
+    binary_puzzle_stats_t stats;
+    uint32_t rng_state = binary_puzzle_rng_seed(options->seed);
+    uint32_t attempt_ct;
+    uint8_t i, j;
+    size_t k;
+    bool *solution
+        = malloc((size_t)options->size * options->size * sizeof(bool));
+    if (solution == NULL) {
+        return BINARY_PUZZLE_ERR_NO_MEMORY;
+    }
+
+    memset(&stats, 0, sizeof(binary_puzzle_stats_t));
+    for (k = 0; k < count && status == BINARY_PUZZLE_OK; k++) {
+        for (attempt_ct = 0; status == BINARY_PUZZLE_OK; attempt_ct++) {
+            if (attempt_ct == DEDUP_MAX_ATTEMPTS) {
+                status = BINARY_PUZZLE_ERR_EXHAUSTED;
+                break;
+            }
+            puzzle_options.seed = batch_seed(options, k, count, attempt_ct);
+            if (k == 0 && attempt_ct == 0) {
+                status = binary_puzzle_generate(&puzzle_options, &out[k]);
+                for (i = 0; i < options->size && status == BINARY_PUZZLE_OK;
+                     i++) {
+                    for (j = 0; j < options->size; j++) {
+                        solution[i * options->size + j]
+                            = binary_puzzle_get_solution(out[k], i, j);
+                    }
+                }
+            } else {
+                /* duplicates walk on further from where they ended up */
+                status = binary_puzzle_mix_solution(
+                    solution, options->size, options->batch_mixing_moves,
+                    &rng_state);
+                if (status == BINARY_PUZZLE_OK) {
+                    status = binary_puzzle_mask_solution(
+                        &puzzle_options, solution, &stats, &out[k]);
+                }
+            }
+            if (status != BINARY_PUZZLE_OK || options->dedup == NULL
+                || binary_puzzle_set_insert(options->dedup, out[k]))
+                break;
+            binary_puzzle_destroy(out[k]);
+            out[k] = NULL;
+        }
+    }
+
+    free(solution);
+    return status;
+}
+
+binary_puzzle_status_t
+binary_puzzle_generate_batch(const binary_puzzle_options_t *options,
+                             BinaryPuzzle **out, size_t count) {
+    binary_puzzle_options_t puzzle_options = *options;
+    binary_puzzle_status_t status = BINARY_PUZZLE_OK;
+    Batch *batch = NULL;
+    size_t k, lane, cell_ct;
+    uint32_t attempt_ct;
+
+    for (k = 0; k < count; k++) {
+        out[k] = NULL;
+    }
+    if (options->size == 0 || options->size % 2 != 0
+        || options->difficulty > BINARY_PUZZLE_HARD) {
+        return BINARY_PUZZLE_ERR_INVALID_ARGUMENT;
+    }
+
+    /* puzzles generated together would interleave in one trace */
+    puzzle_options.trace = NULL;
+    if (options->batch_variants) {
+        status = batch_generate_variants(&puzzle_options, out, count);
+        goto binary_puzzle_generate_batch_done;
+    }
+    if (options->batch_mixing_moves > 0) {
+        status = batch_generate_mixed(&puzzle_options, out, count);
+        goto binary_puzzle_generate_batch_done;
+    }
+    if (options->size > BATCH_MAX_SIZE) {
+        for (k = 0; k < count && status == BINARY_PUZZLE_OK; k++) {
+            for (attempt_ct = 0; status == BINARY_PUZZLE_OK; attempt_ct++) {
+                if (attempt_ct == DEDUP_MAX_ATTEMPTS) {
+                    status = BINARY_PUZZLE_ERR_EXHAUSTED;
+                    break;
+                }
+                puzzle_options.seed = batch_seed(options, k, count, attempt_ct);
+                status = binary_puzzle_generate(&puzzle_options, &out[k]);
+                if (status != BINARY_PUZZLE_OK || options->dedup == NULL
+                    || binary_puzzle_set_insert(options->dedup, out[k]))
+                    break;
+                binary_puzzle_destroy(out[k]);
+                out[k] = NULL;
+            }
+        }
+        goto binary_puzzle_generate_batch_done;
+    }
+
+    batch = calloc(1, sizeof(Batch));
+    if (batch == NULL) {
+        return BINARY_PUZZLE_ERR_NO_MEMORY;
+    }
+    batch->options = options;
+    batch->count = count;
+    batch->size = options->size;
+    batch->full = (uint32_t)(((uint64_t)1 << options->size) - 1);
+    batch->propagate = batch_select_kernel();
+    cell_ct = (size_t)options->size * options->size;
+    for (lane = 0; lane < BATCH_LANES; lane++) {
+        batch->lanes[lane].guesses = malloc(cell_ct * sizeof(BatchGuess));
+        batch->lanes[lane].snapshots
+            = malloc(cell_ct * 2 * options->size * sizeof(uint32_t));
+        if (batch->lanes[lane].guesses == NULL
+            || batch->lanes[lane].snapshots == NULL) {
+            status = BINARY_PUZZLE_ERR_NO_MEMORY;
+            goto binary_puzzle_generate_batch_done;
+        }
+    }
+
+    status = batch_generate(batch, out, count);
+
+binary_puzzle_generate_batch_done:
+    if (batch != NULL) {
+        for (lane = 0; lane < BATCH_LANES; lane++) {
+            free(batch->lanes[lane].guesses);
+            free(batch->lanes[lane].snapshots);
+        }
+        free(batch);
+    }
+    if (status != BINARY_PUZZLE_OK) {
+        for (k = 0; k < count; k++) {
+            binary_puzzle_destroy(out[k]);
+            out[k] = NULL;
+        }
+    }
+    return status;
+}
@@ -0,0 +1,159 @@
+/*
+ * One propagation round over every board of a `BatchBoards`, written once and
+ * instantiated per instruction set by batch.c. The includer defines:
+ *
+ * KERNEL_NAME      name of the generated function
+ * KERNEL_TARGET    function attributes selecting the instruction set
+ * KERNEL_WORD      type holding the same row of KERNEL_LANES boards
+ * KERNEL_LANES     number of `uint32_t` lanes in a KERNEL_WORD
+ * KERNEL_MASK(x)   all ones in the lanes where comparison `x` holds
+ *
+ * Bit `j` of a row word is column `j`. Cells forced by the 3-in-a-row and
+ * evenness rules are filled in, and `changed`/`conflict` are set to nonzero
+ * for each board that gained cells or broke a rule (3 in a row, a line with
+ * more than half of one value, or two equal complete rows or columns).
+ */
+
+KERNEL_TARGET static void KERNEL_NAME(BatchBoards *boards, uint8_t size,
+                                      uint32_t *changed, uint32_t *conflict) {
+    KERNEL_WORD ones[BATCH_MAX_SIZE], zeros[BATCH_MAX_SIZE];
+    /* bit-sliced per-column counts, bit `b` of every count in word `b` */
+    KERNEL_WORD ones_ct[BATCH_COUNT_BITS], zeros_ct[BATCH_COUNT_BITS];
+    KERNEL_WORD zero, full, any_changed, any_conflict;
+    KERNEL_WORD ones_full, zeros_full, ones_over, zeros_over, ones_eq, zeros_eq;
+    KERNEL_WORD o, z, pairs, gaps, forced_zero, forced_one, unknown, carry, tmp;
+    KERNEL_WORD known_both, differ;
+    const uint32_t half = size / 2;
+    size_t lane, r, s;
+    int b;
+
+    memset(&zero, 0, sizeof(KERNEL_WORD));
+    full = zero + (uint32_t)(((uint64_t)1 << size) - 1);
+
+    for (lane = 0; lane < BATCH_LANES; lane += KERNEL_LANES) {
+        any_changed = zero;
+        any_conflict = zero;
+        for (b = 0; b < BATCH_COUNT_BITS; b++) {
+            ones_ct[b] = zero;
+            zeros_ct[b] = zero;
+        }
+        for (r = 0; r < size; r++) {
+            memcpy(&ones[r], &boards->ones[r][lane], sizeof(KERNEL_WORD));
+            memcpy(&zeros[r], &boards->zeros[r][lane], sizeof(KERNEL_WORD));
+
+            carry = ones[r];
+            for (b = 0; b < BATCH_COUNT_BITS; b++) {
+                tmp = ones_ct[b] & carry;
+                ones_ct[b] ^= carry;
+                carry = tmp;
+            }
+            carry = zeros[r];
+            for (b = 0; b < BATCH_COUNT_BITS; b++) {
+                tmp = zeros_ct[b] & carry;
+                zeros_ct[b] ^= carry;
+                carry = tmp;
+            }
+        }
+
+        /* columns holding exactly / more than half of a value */
+        ones_eq = full;
+        zeros_eq = full;
+        ones_over = zero;
+        zeros_over = zero;
+        for (b = BATCH_COUNT_BITS - 1; b >= 0; b--) {
+            if (half >> b & 1) {
+                ones_eq &= ones_ct[b];
+                zeros_eq &= zeros_ct[b];
+            } else {
+                ones_over |= ones_eq & ones_ct[b];
+                zeros_over |= zeros_eq & zeros_ct[b];
+                ones_eq &= ~ones_ct[b];
+                zeros_eq &= ~zeros_ct[b];
+            }
+        }
+        any_conflict |= KERNEL_MASK(((ones_over | zeros_over) & full) != 0);
+
+        for (r = 0; r < size; r++) {
+            o = ones[r];
+            z = zeros[r];
+
+            /* 3-in-a-row rule along the row */
+            pairs = o & (o >> 1);
+            gaps = o & (o >> 2);
+            forced_zero = (pairs >> 1) | (pairs << 2) | (gaps << 1);
+            any_conflict |= KERNEL_MASK((pairs & (o >> 2)) != 0);
+            pairs = z & (z >> 1);
+            gaps = z & (z >> 2);
+            forced_one = (pairs >> 1) | (pairs << 2) | (gaps << 1);
+            any_conflict |= KERNEL_MASK((pairs & (z >> 2)) != 0);
+
+            /* 3-in-a-row rule along the columns */
+            if (r >= 2) {
+                forced_zero |= ones[r - 1] & ones[r - 2];
+                forced_one |= zeros[r - 1] & zeros[r - 2];
+                any_conflict |= KERNEL_MASK((o & ones[r - 1] & ones[r - 2]) != 0);
+                any_conflict |= KERNEL_MASK((z & zeros[r - 1] & zeros[r - 2])
+                                            != 0);
+            }
+            if (r + 2 < size) {
+                forced_zero |= ones[r + 1] & ones[r + 2];
+                forced_one |= zeros[r + 1] & zeros[r + 2];
+            }
+            if (r >= 1 && r + 1 < size) {
+                forced_zero |= ones[r - 1] & ones[r + 1];
+                forced_one |= zeros[r - 1] & zeros[r + 1];
+            }
+
+            /* evenness rule */
+            ones_full = o - ((o >> 1) & 0x55555555U);
+            ones_full = (ones_full & 0x33333333U)
+                        + ((ones_full >> 2) & 0x33333333U);
+            ones_full = (ones_full + (ones_full >> 4)) & 0x0F0F0F0FU;
+            ones_full = (ones_full * 0x01010101U) >> 24;
+            zeros_full = z - ((z >> 1) & 0x55555555U);
+            zeros_full = (zeros_full & 0x33333333U)
+                         + ((zeros_full >> 2) & 0x33333333U);
+            zeros_full = (zeros_full + (zeros_full >> 4)) & 0x0F0F0F0FU;
+            zeros_full = (zeros_full * 0x01010101U) >> 24;
+            any_conflict |= KERNEL_MASK(ones_full > half);
+            any_conflict |= KERNEL_MASK(zeros_full > half);
+            forced_zero |= KERNEL_MASK(ones_full == half) | ones_eq;
+            forced_one |= KERNEL_MASK(zeros_full == half) | zeros_eq;
+
+            /* uniqueness rule along the rows */
+            for (s = r + 1; s < size; s++) {
+                any_conflict |= KERNEL_MASK(
+                    ((o ^ ones[s]) | (full ^ (o | z))
+                     | (full ^ (ones[s] | zeros[s])))
+                    == 0);
+            }
+
+            unknown = full & ~(o | z);
+            forced_zero &= unknown;
+            forced_one &= unknown;
+            any_conflict |= KERNEL_MASK((forced_zero & forced_one) != 0);
+            any_changed |= KERNEL_MASK((forced_zero | forced_one) != 0);
+            ones[r] = o | forced_one;
+            zeros[r] = z | forced_zero;
+        }
+
+        /* uniqueness rule along the columns, comparing columns `s` apart */
+        for (s = 1; s < size; s++) {
+            known_both = full >> s;
+            differ = zero;
+            for (r = 0; r < size; r++) {
+                tmp = ones[r] | zeros[r];
+                known_both &= tmp & (tmp >> s);
+                differ |= ones[r] ^ (ones[r] >> s);
+            }
+            any_conflict |= KERNEL_MASK((known_both & ~differ) != 0);
+        }
+
+        for (r = 0; r < size; r++) {
+            memcpy(&boards->ones[r][lane], &ones[r], sizeof(KERNEL_WORD));
+            memcpy(&boards->zeros[r][lane], &zeros[r], sizeof(KERNEL_WORD));
+        }
+        memcpy(&changed[lane], &any_changed, sizeof(KERNEL_WORD));
+        memcpy(&conflict[lane], &any_conflict, sizeof(KERNEL_WORD));
+    }
+}
@@ -1,53 +1,86 @@
+#define _POSIX_C_SOURCE 200809L
 #include "binary_puzzle.h"
-#include "colors.h"
-#include "reporter.h"
-#include "string_builder.h"
-#include <errno.h>
+#include "binary_puzzle_internal.h"
 #include <stdarg.h>
 #include <stdbool.h>
-#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <sys/ioctl.h>
-#include <termios.h>
-#include <unistd.h>
+#include <time.h>
 
-#define FILENAME "binary_puzzle.c"
+/* `binary_puzzle_create` races searches for boards this large */
+#define PORTFOLIO_MIN_SIZE 40
+
+/* bulk masking tests batches while at least this share of cells is hidden */
+#define MASK_BULK_MIN_RATE 0.7
+/* cells tested with one solve at most */
+#define MASK_BATCH_MAX 64
+/* tested cells the recent acceptance rate mostly reflects */
+#define MASK_RATE_WINDOW 8
 
 typedef enum { CELL_ZERO, CELL_ONE, CELL_INVALID, CELL_UNKNOWN } cell_state_t;
 
+/* `GuessQueue::position` of a cell that is set */
+#define NOT_QUEUED ((size_t)-1)
+
+/*
+ * The unset cells of a running search, in a max-heap on how dramatic a guess
+ * at each would be. A cell's key only depends on how many ones and zeros its
+ * row and column hold, so setting or unsetting a cell only marks its row and
+ * column stale, and rekeying those before a guess brings the most dramatic
+ * cell to the top.
+ */
+typedef struct {
+    /* ones and zeros set per row and column */
+    uint8_t *row_ones;
+    uint8_t *row_zeros;
+    uint8_t *col_ones;
+    uint8_t *col_zeros;
+    /* rows, then columns, whose keys are out of date */
+    bool *stale;
+    /* row-major cell indices, ties going to the lowest */
+    size_t *heap;
+    size_t heap_ct;
+    /* where each cell sits in `heap`, or `NOT_QUEUED` */
+    size_t *position;
+    float *key;
+    /* cells set so far, as `cell << 1 | value`, to be unset in reverse */
+    size_t *set_cells;
+    size_t set_ct;
+} GuessQueue;
+
 struct BinaryPuzzle {
     uint8_t size;
     bool **solution;
     /* false values in mask represent hidden values in solution */
     bool **mask;
 
-    cell_state_t **user_guesses;
-
-    uint8_t i_selected;
-    uint8_t j_selected;
+    /* random state and conflict count of the running search */
+    SearchContext search;
+    /* solution the running search must not return, `NULL` if none */
+    bool **excluded;
+    /* guess candidates of the running search, allocated on first use */
+    GuessQueue queue;
+    /* threads sharing propagation rounds, `NULL` to propagate serially */
+    BinaryPuzzlePool *pool;
+    /* row-major results of the running round, while `pool` is set */
+    cell_state_t *deduced;
+    binary_puzzle_stats_t stats;
+
+    /* specialized solver and masker for this size, `NULL` if none */
+    const BinaryPuzzleKernel *kernel;
 };
 
-/**
- * Initialize binary puzzle with random values.
- *
- * Return `true` iff successful.
- */
-static bool binary_puzzle_initialize(BinaryPuzzle *self);
-
 static void **get_empty_board(BinaryPuzzle *self, uint8_t member_size,
                               uint8_t default_value) {
     size_t i;
     void *contents;
     void **board = calloc(self->size, sizeof(void *));
     if (board == NULL) {
-        report_system_error(FILENAME ": memory allocation failure");
         return NULL;
     }
 
     contents = calloc(self->size * self->size, member_size);
     if (contents == NULL) {
-        report_system_error(FILENAME ": memory allocation failure");
         free(board);
         return NULL;
     }
@@ -65,255 +98,136 @@ static void **get_empty_board(BinaryPuzzle *self, uint8_t member_size,
     return board;
 }
 
-static cell_state_t binary_puzzle_get_cell_state(BinaryPuzzle *self,
-                                                 bool **initialized, size_t i,
-                                                 size_t j) {
-    if (i < self->size && j < self->size) {
-        if (initialized[i][j]) {
-            return self->solution[i][j] ? CELL_ONE : CELL_ZERO;
-        }
-    }
-    return CELL_UNKNOWN;
+uint32_t binary_puzzle_rng_seed(uint32_t seed) {
+    /* scramble so that consecutive seeds give unrelated sequences */
+    seed ^= seed >> 16;
+    seed *= 0x45d9f3bU;
+    seed ^= seed >> 16;
+    seed *= 0x45d9f3bU;
+    seed ^= seed >> 16;
+    return seed != 0 ? seed : 1;
 }
 
-struct {
-    uint16_t row_ct;
-    uint16_t col_ct;
-    struct termios orig_termios;
-} g_term;
-
-static void disable_raw_mode(void) {
-    if (tcsetattr(STDIN_FILENO, TCSAFLUSH, &g_term.orig_termios) == -1) {
-        printf(CLEAR_SCREEN RESET_CURSOR SHOW_CURSOR);
-        report_system_error(FILENAME ": failed to disable raw mode");
-        exit(1);
-    }
+double binary_puzzle_rng_next(uint32_t *state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return (x >> 8) / 16777216.0;
 }
 
-static void update_window_size(void) {
-    struct winsize ws;
-
-    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == -1 || ws.ws_col == 0) {
-        report_system_error(FILENAME ": failed to get window size");
-        exit(1);
-    }
-
-    g_term.col_ct = ws.ws_col;
-    g_term.row_ct = ws.ws_row;
+uint32_t binary_puzzle_restart_seed(uint32_t seed, uint32_t restart_ct) {
+    return seed ^ (restart_ct * 0x9E3779B9U);
 }
 
-static void enable_raw_mode(void) {
-    struct termios raw;
-
-    if (tcgetattr(STDIN_FILENO, &g_term.orig_termios) == -1) {
-        report_system_error(FILENAME ": failed to get terminal attributes");
-        exit(1);
+uint32_t binary_puzzle_restart_cutoff(const binary_puzzle_options_t *options,
+                                      uint32_t restart_ct) {
+    uint32_t cutoff = options->restart_base;
+    uint32_t size, seq;
+    switch (options->restart_schedule) {
+    case BINARY_PUZZLE_RESTART_LUBY:
+        /* find the `restart_ct`th term of 1, 1, 2, 1, 1, 2, 4, ... */
+        for (size = 1, seq = 0; size < restart_ct + 1; seq++) {
+            size = 2 * size + 1;
+        }
+        while (size - 1 != restart_ct) {
+            size = (size - 1) >> 1;
+            seq--;
+            restart_ct %= size;
+        }
+        for (; seq > 0 && cutoff <= UINT32_MAX / 2; seq--) {
+            cutoff *= 2;
+        }
+        return cutoff;
+    case BINARY_PUZZLE_RESTART_GEOMETRIC:
+        for (; restart_ct > 0 && cutoff <= UINT32_MAX / 3 * 2; restart_ct--) {
+            cutoff += cutoff / 2;
+        }
+        return cutoff;
+    default:
+        return 0;
     }
-    atexit(disable_raw_mode);
-
-    raw = g_term.orig_termios;
-
-    /* disable ctrl+s and ctrl+q */
-    raw.c_iflag &= ~IXON;
-
-    /* ensure 8th bit preserved */
-    raw.c_iflag &= ~ISTRIP;
-
-    /* disable ctrl+v */
-    raw.c_lflag &= ~IEXTEN;
+}
 
-    /* disable showing charcters as they're typed */
-    raw.c_lflag &= ~ECHO;
+struct BinaryPuzzleCancel {
+    int requested;
+};
 
-    /* disable canonical mode (read byte-by-byte) */
-    raw.c_lflag &= ~ICANON;
+BinaryPuzzleCancel *binary_puzzle_cancel_create(void) {
+    return calloc(1, sizeof(BinaryPuzzleCancel));
+}
 
-    /* disable output processing */
-    raw.c_oflag &= ~OPOST;
+void binary_puzzle_cancel_request(BinaryPuzzleCancel *self) {
+    __atomic_store_n(&self->requested, 1, __ATOMIC_RELAXED);
+}
 
-    /* ensure 8 bits per character */
-    raw.c_cflag |= CS8;
+void binary_puzzle_cancel_destroy(BinaryPuzzleCancel *self) { free(self); }
 
-    /* set minimum bytes to read for read() to return */
-    raw.c_cc[VMIN] = 0;
+/**
+ * Return the `CLOCK_MONOTONIC` time in microseconds.
+ */
+static uint64_t monotonic_us(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
 
-    /* time in deciseconds before read() should return */
-    raw.c_cc[VTIME] = 1;
+bool binary_puzzle_search_cancelled(SearchContext *context) {
+    if (context->cancelled != NULL
+        && __atomic_load_n(context->cancelled, __ATOMIC_RELAXED) != 0)
+        return true;
+    if (context->cancel != NULL
+        && __atomic_load_n(&context->cancel->requested, __ATOMIC_RELAXED) != 0)
+        return true;
+    if (context->deadline_us != 0 && !context->timed_out
+        && monotonic_us() >= context->deadline_us)
+        context->timed_out = true;
+    return context->timed_out;
+}
 
-    if (tcsetattr(STDIN_FILENO, TCSAFLUSH, &raw) == -1) {
-        report_system_error(FILENAME ": failed to enter raw mode");
-        exit(1);
+solve_status_t binary_puzzle_search_conflict(SearchContext *context) {
+    context->conflict_ct++;
+    if (binary_puzzle_search_cancelled(context)) {
+        return SOLVE_CANCELLED;
+    }
+    if (context->conflict_limit != 0
+        && context->conflict_ct >= context->conflict_limit) {
+        return SOLVE_RESTART;
     }
+    return SOLVE_REACHED_INVALID;
 }
 
-static void binary_puzzle_update_screen(BinaryPuzzle *self) {
-    const uint16_t min_row_ct = self->size * 3;
-    const uint16_t min_col_ct = self->size * 5;
-    uint16_t i, j;
-    uint8_t row, col;
-    StringBuilder *contents = string_builder_create();
-    const char *pls_expand_screen = "Screen size too small";
-    string_builder_set(contents, CLEAR_SCREEN RESET_CURSOR HIDE_CURSOR);
-    update_window_size();
-    if (g_term.row_ct >= min_row_ct && g_term.col_ct >= min_col_ct) {
-        for (row = 0; 2 * row < g_term.row_ct - min_row_ct; row++) {
-            string_builder_append(contents, "\r\n");
-        }
-
-        for (i = 0; i < self->size; i++) {
-            /* top */
-            for (col = 0; 2 * col < g_term.col_ct - min_col_ct; col++) {
-                string_builder_append(contents, " ");
-            }
-            for (j = 0; j < self->size; j++) {
-                if (i == self->i_selected && j == self->j_selected) {
-                    string_builder_append(contents, "╔═══╗");
-                } else {
-                    string_builder_append(contents, "┌───┐");
-                }
-            }
-            string_builder_append(contents, "\r\n");
+/**
+ * Return the microseconds elapsed since `start`.
+ */
+static uint32_t elapsed_us(const struct timespec *start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) * 1000000
+           + (now.tv_nsec - start->tv_nsec) / 1000;
+}
 
-            /* middle */
-            for (col = 0; 2 * col < g_term.col_ct - min_col_ct; col++) {
-                string_builder_append(contents, " ");
-            }
-            for (j = 0; j < self->size; j++) {
-                if (i == self->i_selected && j == self->j_selected) {
-                    string_builder_append(contents, "║ ");
-                } else {
-                    string_builder_append(contents, "│ ");
-                }
-                if (!self->mask[i][j]) {
-                    switch (self->user_guesses[i][j]) {
-                    case CELL_ZERO:
-                        string_builder_append(contents, CYAN "0" RESET);
-                        break;
-                    case CELL_ONE:
-                        string_builder_append(contents, CYAN "1" RESET);
-                        break;
-                    case CELL_UNKNOWN:
-                        string_builder_append(contents, BLUE "_" RESET);
-                        break;
-                    default:
-                        string_builder_append(contents, RED "?" RESET);
-                        break;
-                    }
-                } else {
-                    string_builder_append(contents, self->solution[i][j]
-                                                        ? GREEN "1" RESET
-                                                        : GREEN "0" RESET);
-                }
+static void binary_puzzle_seed(BinaryPuzzle *self, uint32_t seed) {
+    self->search.rng_state = binary_puzzle_rng_seed(seed);
+}
 
-                if (i == self->i_selected && j == self->j_selected) {
-                    string_builder_append(contents, " ║");
-                } else {
-                    string_builder_append(contents, " │");
-                }
-            }
-            string_builder_append(contents, "\r\n");
+/**
+ * Return a pseudo-random number in [0, 1).
+ */
+static double binary_puzzle_random(BinaryPuzzle *self) {
+    return binary_puzzle_rng_next(&self->search.rng_state);
+}
 
-            /* bottom */
-            for (col = 0; 2 * col < g_term.col_ct - min_col_ct; col++) {
-                string_builder_append(contents, " ");
-            }
-            for (j = 0; j < self->size; j++) {
-                if (i == self->i_selected && j == self->j_selected) {
-                    string_builder_append(contents, "╚═══╝");
-                } else {
-                    string_builder_append(contents, "└───┘");
-                }
-            }
-            if (g_term.row_ct != min_row_ct || i != self->size) {
-                string_builder_append(contents, "\r\n");
-            }
-        }
-    } else {
-        for (row = 0; 2 * row < g_term.row_ct; row++) {
-            string_builder_append(contents, "\r\n");
-        }
-        if (g_term.col_ct >= strlen(pls_expand_screen)) {
-            for (col = 0; 2 * col < g_term.col_ct - strlen(pls_expand_screen);
-                 col++) {
-                string_builder_append(contents, " ");
-            }
-            string_builder_append(contents, pls_expand_screen);
-        }
-    }
-    write(STDOUT_FILENO, string_builder_to_string(contents),
-          string_builder_len(contents));
-    string_builder_destroy(contents);
-}
-
-void binary_puzzle_interactive(BinaryPuzzle *self) {
-    char key;
-    int read_status;
-    bool keep_playing = true;
-    enable_raw_mode();
-    self->user_guesses = (cell_state_t **)get_empty_board(
-        self, sizeof(cell_state_t), CELL_UNKNOWN);
-
-    while (keep_playing) {
-        binary_puzzle_update_screen(self);
-        read_status = read(STDIN_FILENO, &key, 1);
-        if (read_status == 1) {
-            switch (key) {
-            case 'q':
-                printf(CLEAR_SCREEN RESET_CURSOR SHOW_CURSOR);
-                keep_playing = false;
-                break;
-            case 'h':
-                self->j_selected += self->size - 1;
-                self->j_selected %= self->size;
-                break;
-            case 'j':
-                self->i_selected++;
-                self->i_selected %= self->size;
-                break;
-            case 'k':
-                self->i_selected += self->size - 1;
-                self->i_selected %= self->size;
-                break;
-            case 'l':
-                self->j_selected++;
-                self->j_selected %= self->size;
-                break;
-            case '\n':
-            case ' ':
-                switch (
-                    self->user_guesses[self->i_selected][self->j_selected]) {
-                case CELL_UNKNOWN:
-                    self->user_guesses[self->i_selected][self->j_selected]
-                        = CELL_ZERO;
-                    break;
-                case CELL_ZERO:
-                    self->user_guesses[self->i_selected][self->j_selected]
-                        = CELL_ONE;
-                    break;
-                case CELL_ONE:
-                    self->user_guesses[self->i_selected][self->j_selected]
-                        = CELL_UNKNOWN;
-                    break;
-                default:
-                    break;
-                }
-                break;
-            case '0':
-                self->user_guesses[self->i_selected][self->j_selected]
-                    = CELL_ZERO;
-                break;
-            case '1':
-                self->user_guesses[self->i_selected][self->j_selected]
-                    = CELL_ONE;
-                break;
-            default:
-                break;
-            }
-        } else if (read_status == -1 && errno != EAGAIN) {
-            report_system_error(FILENAME ": failed to get user input");
-            exit(1);
+static cell_state_t binary_puzzle_get_cell_state(BinaryPuzzle *self,
+                                                 bool **initialized, size_t i,
+                                                 size_t j) {
+    if (i < self->size && j < self->size) {
+        if (initialized[i][j]) {
+            return self->solution[i][j] ? CELL_ONE : CELL_ZERO;
         }
     }
+    return CELL_UNKNOWN;
 }
 
 static cell_state_t cell_state_combine(size_t cell_ct, ...) {
@@ -451,96 +365,238 @@ static cell_state_t binary_puzzle_check_uniqueness_rule(BinaryPuzzle *self,
     return CELL_UNKNOWN;
 }
 
-static float binary_puzzle_get_one_probability(BinaryPuzzle *self,
-                                               bool **initialized, size_t i,
-                                               size_t j) {
-    size_t k;
-    uint8_t row_ones_needed = self->size / 2;
-    uint8_t row_zeroes_needed = self->size / 2;
-    uint8_t col_ones_needed = self->size / 2;
-    uint8_t col_zeroes_needed = self->size / 2;
-    uint16_t one_straws;
-    uint16_t zero_straws;
+/**
+ * Return the chance that cell (i, j) is a one, judging by how many ones and
+ * zeros its row and column still need.
+ */
+static float guess_queue_one_probability(const BinaryPuzzle *self, size_t i,
+                                         size_t j) {
+    const GuessQueue *queue = &self->queue;
+    uint8_t row_ones_needed = self->size / 2 - queue->row_ones[i];
+    uint8_t row_zeroes_needed = self->size / 2 - queue->row_zeros[i];
+    uint8_t col_ones_needed = self->size / 2 - queue->col_ones[j];
+    uint8_t col_zeroes_needed = self->size / 2 - queue->col_zeros[j];
+    uint16_t one_straws = row_ones_needed * col_ones_needed;
+    uint16_t zero_straws = row_zeroes_needed * col_zeroes_needed;
 
-    for (k = 0; k < self->size; k++) {
-        if (initialized[i][k]) {
-            if (self->solution[i][k]) {
-                row_ones_needed--;
-            } else {
-                row_zeroes_needed--;
+    return (1.0f * one_straws) / (one_straws + zero_straws);
+}
+
+static float dramaticity(float probability) {
+    return probability < 0.5 ? 1 - probability : probability;
+}
+
+/**
+ * Return the heap key of unset cell (i, j).
+ */
+static float guess_queue_key(const BinaryPuzzle *self, size_t i, size_t j) {
+    const GuessQueue *queue = &self->queue;
+
+    /* no value fits, which the rules refute before it could be guessed */
+    if ((queue->row_ones[i] == self->size / 2
+         || queue->col_ones[j] == self->size / 2)
+        && (queue->row_zeros[i] == self->size / 2
+            || queue->col_zeros[j] == self->size / 2))
+        return -1;
+    return dramaticity(guess_queue_one_probability(self, i, j));
+}
+
+/**
+ * Return `true` iff cell `a` belongs above cell `b` in the heap.
+ */
+static bool guess_queue_before(const GuessQueue *queue, size_t a, size_t b) {
+    return queue->key[a] > queue->key[b]
+           || (queue->key[a] == queue->key[b] && a < b);
+}
+
+static void guess_queue_place(GuessQueue *queue, size_t pos, size_t cell) {
+    queue->heap[pos] = cell;
+    queue->position[cell] = pos;
+}
+
+/**
+ * Move the cell at `pos` up or down until the heap is in order again.
+ */
+static void guess_queue_sift(GuessQueue *queue, size_t pos) {
+    const size_t cell = queue->heap[pos];
+    size_t child;
+
+    while (pos > 0
+           && guess_queue_before(queue, cell, queue->heap[(pos - 1) / 2])) {
+        guess_queue_place(queue, pos, queue->heap[(pos - 1) / 2]);
+        pos = (pos - 1) / 2;
+    }
+    while ((child = 2 * pos + 1) < queue->heap_ct) {
+        if (child + 1 < queue->heap_ct
+            && guess_queue_before(queue, queue->heap[child + 1],
+                                  queue->heap[child]))
+            child++;
+        if (!guess_queue_before(queue, queue->heap[child], cell))
+            break;
+        guess_queue_place(queue, pos, queue->heap[child]);
+        pos = child;
+    }
+    guess_queue_place(queue, pos, cell);
+}
+
+/**
+ * Recompute the keys of the unset cells in every stale row and column.
+ */
+static void guess_queue_refresh(BinaryPuzzle *self) {
+    GuessQueue *queue = &self->queue;
+    size_t line, k, cell;
+
+    for (line = 0; line < 2 * (size_t)self->size; line++) {
+        if (!queue->stale[line])
+            continue;
+        queue->stale[line] = false;
+        for (k = 0; k < self->size; k++) {
+            cell = line < self->size ? line * self->size + k
+                                     : k * self->size + line - self->size;
+            if (queue->position[cell] != NOT_QUEUED) {
+                queue->key[cell]
+                    = guess_queue_key(self, cell / self->size,
+                                      cell % self->size);
+                guess_queue_sift(queue, queue->position[cell]);
             }
         }
-        if (initialized[k][j]) {
-            if (self->solution[k][j]) {
-                col_ones_needed--;
-            } else {
-                col_zeroes_needed--;
-            }
+    }
+}
+
+/**
+ * Take cell (i, j), just set to its value in `self->solution`, out of the
+ * queue.
+ */
+static void guess_queue_set(BinaryPuzzle *self, size_t i, size_t j) {
+    GuessQueue *queue = &self->queue;
+    const size_t cell = i * self->size + j;
+    const size_t pos = queue->position[cell];
+    const bool value = self->solution[i][j];
+
+    if (value) {
+        queue->row_ones[i]++;
+        queue->col_ones[j]++;
+    } else {
+        queue->row_zeros[i]++;
+        queue->col_zeros[j]++;
+    }
+    queue->position[cell] = NOT_QUEUED;
+    if (pos != --queue->heap_ct) {
+        guess_queue_place(queue, pos, queue->heap[queue->heap_ct]);
+        guess_queue_sift(queue, pos);
+    }
+    queue->set_cells[queue->set_ct++] = cell << 1 | value;
+    queue->stale[i] = queue->stale[self->size + j] = true;
+}
+
+/**
+ * Put back every cell set since `set_ct` cells were, latest first.
+ */
+static void guess_queue_unset_to(BinaryPuzzle *self, size_t set_ct) {
+    GuessQueue *queue = &self->queue;
+    size_t cell, i, j;
+    bool value;
+
+    while (queue->set_ct > set_ct) {
+        cell = queue->set_cells[--queue->set_ct] >> 1;
+        value = queue->set_cells[queue->set_ct] & 1;
+        i = cell / self->size;
+        j = cell % self->size;
+        if (value) {
+            queue->row_ones[i]--;
+            queue->col_ones[j]--;
+        } else {
+            queue->row_zeros[i]--;
+            queue->col_zeros[j]--;
         }
+        queue->key[cell] = guess_queue_key(self, i, j);
+        guess_queue_place(queue, queue->heap_ct++, cell);
+        guess_queue_sift(queue, queue->heap_ct - 1);
+        queue->stale[i] = queue->stale[self->size + j] = true;
     }
-    one_straws = row_ones_needed * col_ones_needed;
-    zero_straws = row_zeroes_needed * col_zeroes_needed;
-    return (1.0f * one_straws) / (one_straws + zero_straws);
 }
 
-#pragma GCC push_options
-#pragma GCC optimize("O0")
-static void binary_puzzle_print_initialization_frame(BinaryPuzzle *self,
-                                                     bool **initialized,
-                                                     bool sleep) {
-    size_t i, j;
-    printf(CLEAR_SCREEN);
+/**
+ * Fill the queue with the cells not set in `initialized`.
+ *
+ * Return `true` iff successful.
+ */
+static bool guess_queue_reset(BinaryPuzzle *self, bool **initialized) {
+    GuessQueue *queue = &self->queue;
+    const size_t cell_ct = (size_t)self->size * self->size;
+    size_t i, j, cell, pos;
+
+    if (queue->heap == NULL) {
+        queue->row_ones = malloc(4 * self->size);
+        queue->heap = malloc(cell_ct * sizeof(size_t));
+        queue->position = malloc(cell_ct * sizeof(size_t));
+        queue->key = malloc(cell_ct * sizeof(float));
+        queue->set_cells = malloc(cell_ct * sizeof(size_t));
+        queue->stale = malloc(2 * self->size * sizeof(bool));
+        if (queue->row_ones == NULL || queue->heap == NULL
+            || queue->position == NULL || queue->key == NULL
+            || queue->set_cells == NULL || queue->stale == NULL) {
+            return false;
+        }
+        queue->row_zeros = queue->row_ones + self->size;
+        queue->col_ones = queue->row_zeros + self->size;
+        queue->col_zeros = queue->col_ones + self->size;
+    }
+    memset(queue->row_ones, 0, 4 * self->size);
+    memset(queue->stale, 0, 2 * self->size * sizeof(bool));
     for (i = 0; i < self->size; i++) {
         for (j = 0; j < self->size; j++) {
-            if (!self->mask[i][j]) {
-                printf(BLUE "? " RESET);
-            } else if (initialized == NULL || initialized[i][j]) {
-                printf(GREEN "%s " RESET, self->solution[i][j] ? "1" : "0");
+            if (!initialized[i][j])
+                continue;
+            if (self->solution[i][j]) {
+                queue->row_ones[i]++;
+                queue->col_ones[j]++;
             } else {
-                printf(RED "X " RESET);
+                queue->row_zeros[i]++;
+                queue->col_zeros[j]++;
             }
         }
-        printf("\n");
     }
-    /* sleep */
-    if (sleep) {
-        for (i = 0; i < 20000000; i++) {
+
+    queue->heap_ct = 0;
+    queue->set_ct = 0;
+    for (cell = 0; cell < cell_ct; cell++) {
+        queue->position[cell] = NOT_QUEUED;
+        if (!(*initialized)[cell]) {
+            queue->key[cell]
+                = guess_queue_key(self, cell / self->size, cell % self->size);
+            guess_queue_place(queue, queue->heap_ct++, cell);
         }
     }
+    for (pos = queue->heap_ct / 2; pos > 0; pos--) {
+        guess_queue_sift(queue, pos - 1);
+    }
+    return true;
 }
-#pragma GCC pop_options
 
-void binary_puzzle_print(BinaryPuzzle *self) {
-    binary_puzzle_print_initialization_frame(self, NULL, false);
+static void guess_queue_free(GuessQueue *queue) {
+    free(queue->row_ones);
+    free(queue->heap);
+    free(queue->position);
+    free(queue->stale);
+    free(queue->key);
+    free(queue->set_cells);
 }
 
-typedef enum {
-    SOLVE_SUCCESS,
-    SOLVE_OUT_OF_GUESSES,
-    SOLVE_REACHED_INVALID,
-    SOLVE_SYSTEM_ERROR
-} solve_status_t;
-
 static solve_status_t
-binary_puzzle_initialize_solution(BinaryPuzzle *self, bool **initialized,
-                                  uint16_t allowed_guesses);
+binary_puzzle_search_solution(BinaryPuzzle *self, bool **initialized,
+                              uint16_t allowed_guesses);
 
 static cell_state_t binary_puzzle_get_expected_cell_state(BinaryPuzzle *self,
                                                           bool **initialized,
                                                           size_t i, size_t j);
 
-static float dramaticity(float probability) {
-    return probability < 0.5 ? 1 - probability : probability;
-}
-
 static solve_status_t
 binary_puzzle_make_probable_guess(BinaryPuzzle *self, bool **initialized,
                                   uint16_t allowed_guesses) {
-    size_t most_dramatic_i = 0, most_dramatic_j = 0;
-    size_t i, j;
-    float most_dramatic_one_probability = 0.5;
-    float one_probability;
-    bool contender_found = false;
+    const size_t set_ct = self->queue.set_ct;
+    size_t most_dramatic_i, most_dramatic_j;
+    float most_dramatic_one_probability;
     cell_state_t cell_state;
     solve_status_t solve_status;
 
@@ -549,45 +605,33 @@ binary_puzzle_make_probable_guess(BinaryPuzzle *self, bool **initialized,
     if (allowed_guesses != UINT16_MAX)
         allowed_guesses--;
 
-    for (i = 0; i < self->size; i++) {
-        for (j = 0; j < self->size; j++) {
-            if (!initialized[i][j]) {
-                one_probability = binary_puzzle_get_one_probability(
-                    self, initialized, i, j);
-                if (!contender_found
-                    || dramaticity(one_probability)
-                           > dramaticity(most_dramatic_one_probability)) {
-                    contender_found = true;
-                    most_dramatic_one_probability = one_probability;
-                    most_dramatic_i = i;
-                    most_dramatic_j = j;
-                }
-            }
-        }
-    }
+    guess_queue_refresh(self);
+    most_dramatic_i = self->queue.heap[0] / self->size;
+    most_dramatic_j = self->queue.heap[0] % self->size;
+    most_dramatic_one_probability
+        = guess_queue_one_probability(self, most_dramatic_i, most_dramatic_j);
 
-    cell_state = (1.0 * rand()) / RAND_MAX < most_dramatic_one_probability
+    cell_state = binary_puzzle_random(self) < most_dramatic_one_probability
                      ? CELL_ONE
                      : CELL_ZERO;
 
     self->solution[most_dramatic_i][most_dramatic_j] = cell_state == CELL_ONE;
     initialized[most_dramatic_i][most_dramatic_j] = true;
-#ifdef DEBUG
-    if (allowed_guesses == UINT16_MAX)
-        binary_puzzle_print_initialization_frame(self, initialized, true);
-#endif
-    if ((solve_status = binary_puzzle_initialize_solution(self, initialized,
-                                                          allowed_guesses))
-            != SOLVE_SUCCESS
-        && solve_status != SOLVE_OUT_OF_GUESSES) {
+    guess_queue_set(self, most_dramatic_i, most_dramatic_j);
+    TRACE_EVENT(self->search.trace, BINARY_PUZZLE_EVENT_GUESS, most_dramatic_i,
+                most_dramatic_j, cell_state == CELL_ONE);
+    solve_status
+        = binary_puzzle_search_solution(self, initialized, allowed_guesses);
+    guess_queue_unset_to(self, set_ct);
+    if (solve_status == SOLVE_REACHED_INVALID) {
         self->solution[most_dramatic_i][most_dramatic_j]
             = cell_state != CELL_ONE;
-#ifdef DEBUG
-        if (allowed_guesses == UINT16_MAX)
-            binary_puzzle_print_initialization_frame(self, initialized, true);
-#endif
-        solve_status = binary_puzzle_initialize_solution(self, initialized,
-                                                         allowed_guesses);
+        guess_queue_set(self, most_dramatic_i, most_dramatic_j);
+        TRACE_EVENT(self->search.trace, BINARY_PUZZLE_EVENT_BACKTRACK,
+                    most_dramatic_i, most_dramatic_j, cell_state != CELL_ONE);
+        solve_status
+            = binary_puzzle_search_solution(self, initialized, allowed_guesses);
+        guess_queue_unset_to(self, set_ct);
     }
     return solve_status;
 }
@@ -609,9 +653,152 @@ static cell_state_t binary_puzzle_get_expected_cell_state(BinaryPuzzle *self,
     return cell_state_combine(3, cell_state_a, cell_state_b, cell_state_c);
 }
 
+/* A propagation round shared between the threads of `BinaryPuzzle::pool`. */
+typedef struct {
+    BinaryPuzzle *self;
+    bool **initialized;
+} PropagationRound;
+
+/**
+ * Deduce the unset cells of one band of rows of a round into
+ * `self->deduced`, reading only the board as it stood when the round began.
+ */
+static void propagation_round_run(void *arg, size_t part, size_t thread_ct) {
+    PropagationRound *round = arg;
+    BinaryPuzzle *self = round->self;
+    const size_t first = part * self->size / thread_ct;
+    const size_t last = (part + 1) * self->size / thread_ct;
+    size_t i, j;
+
+    for (i = first; i < last; i++) {
+        for (j = 0; j < self->size; j++) {
+            if (!round->initialized[i][j]) {
+                self->deduced[i * self->size + j]
+                    = binary_puzzle_get_expected_cell_state(
+                        self, round->initialized, i, j);
+            }
+        }
+    }
+}
+
+/**
+ * Return `true` iff `line` of `self->solution`, set in `initialized`, differs
+ * from every other line set in full, `line` being a row if `is_row` and a
+ * column otherwise.
+ */
+static bool binary_puzzle_line_unique(BinaryPuzzle *self, bool **initialized,
+                                      size_t line, bool is_row) {
+    size_t k, l;
+    bool unique;
+
+    for (k = 0; k < self->size; k++) {
+        if (k == line)
+            continue;
+        unique = false;
+        for (l = 0; l < self->size && !unique; l++) {
+            if (is_row) {
+                unique = !initialized[k][l]
+                         || self->solution[k][l] != self->solution[line][l];
+            } else {
+                unique = !initialized[l][k]
+                         || self->solution[l][k] != self->solution[l][line];
+            }
+        }
+        if (!unique)
+            return false;
+    }
+    return true;
+}
+
+/**
+ * Return `true` iff cell (i, j), merged from a round, breaks no rule with the
+ * cells merged before it. Each deduction of a round follows from the board
+ * it started from, but two of them may still clash with each other.
+ */
+static bool binary_puzzle_merge_consistent(BinaryPuzzle *self,
+                                           bool **initialized, size_t i,
+                                           size_t j) {
+    const GuessQueue *queue = &self->queue;
+    const size_t half = self->size / 2;
+    size_t k;
+
+    if (queue->row_ones[i] > half || queue->row_zeros[i] > half
+        || queue->col_ones[j] > half || queue->col_zeros[j] > half)
+        return false;
+    for (k = i < 2 ? 0 : i - 2; k <= i && k + 2 < self->size; k++) {
+        if (initialized[k][j] && initialized[k + 1][j] && initialized[k + 2][j]
+            && self->solution[k][j] == self->solution[k + 1][j]
+            && self->solution[k][j] == self->solution[k + 2][j])
+            return false;
+    }
+    for (k = j < 2 ? 0 : j - 2; k <= j && k + 2 < self->size; k++) {
+        if (initialized[i][k] && initialized[i][k + 1] && initialized[i][k + 2]
+            && self->solution[i][k] == self->solution[i][k + 1]
+            && self->solution[i][k] == self->solution[i][k + 2])
+            return false;
+    }
+    if (queue->row_ones[i] + queue->row_zeros[i] == self->size
+        && !binary_puzzle_line_unique(self, initialized, i, true))
+        return false;
+    if (queue->col_ones[j] + queue->col_zeros[j] == self->size
+        && !binary_puzzle_line_unique(self, initialized, j, false))
+        return false;
+    return true;
+}
+
+/**
+ * Run one propagation round over `initialized` on the threads of
+ * `self->pool`, then merge its deductions in row-major order, setting
+ * `updated` if any cell was set and `has_remaining_cells` if any is left.
+ *
+ * Return `SOLVE_SUCCESS` unless a conflict was reached.
+ */
+static solve_status_t binary_puzzle_propagate_round(BinaryPuzzle *self,
+                                                    bool **initialized,
+                                                    bool *updated,
+                                                    bool *has_remaining_cells) {
+    PropagationRound round;
+    cell_state_t cell_state;
+    size_t i, j;
+
+    round.self = self;
+    round.initialized = initialized;
+    binary_puzzle_pool_run(self->pool, propagation_round_run, &round);
+
+    for (i = 0; i < self->size; i++) {
+        for (j = 0; j < self->size; j++) {
+            if (initialized[i][j])
+                continue;
+            cell_state = self->deduced[i * self->size + j];
+            if (cell_state == CELL_ONE || cell_state == CELL_ZERO) {
+                self->solution[i][j] = cell_state == CELL_ONE;
+                initialized[i][j] = true;
+                guess_queue_set(self, i, j);
+                *updated = true;
+                TRACE_EVENT(self->search.trace, BINARY_PUZZLE_EVENT_ASSIGN, i,
+                            j, cell_state == CELL_ONE);
+                if (!binary_puzzle_merge_consistent(self, initialized, i, j))
+                    return binary_puzzle_search_conflict(&self->search);
+            } else {
+                *has_remaining_cells = true;
+                if (cell_state == CELL_INVALID)
+                    return binary_puzzle_search_conflict(&self->search);
+            }
+        }
+    }
+    return SOLVE_SUCCESS;
+}
+
+/**
+ * Fill in the cells of `self->solution` not set in `initialized` as
+ * `binary_puzzle_initialize_solution` does, with `self->queue` holding
+ * exactly the cells not set in `initialized`. Cells set along the way are
+ * back in the queue on return.
+ */
 static solve_status_t
-binary_puzzle_initialize_solution(BinaryPuzzle *self, bool **initialized,
-                                  uint16_t allowed_guesses) {
+binary_puzzle_search_solution(BinaryPuzzle *self, bool **initialized,
+                              uint16_t allowed_guesses) {
+    const size_t set_ct = self->queue.set_ct;
     size_t i, j;
     /* actual cell state */
     cell_state_t cell_state;
@@ -630,8 +817,20 @@ binary_puzzle_initialize_solution(BinaryPuzzle *self, bool **initialized,
     }
 
     do {
+        /* large boards can sweep for a long time between conflicts */
+        if (binary_puzzle_search_cancelled(&self->search)) {
+            solve_status = SOLVE_CANCELLED;
+            goto binary_puzzle_solve_done;
+        }
         updated = false;
         has_remaining_cells = false;
+        if (self->pool != NULL) {
+            solve_status = binary_puzzle_propagate_round(
+                self, frame_initialized, &updated, &has_remaining_cells);
+            if (solve_status != SOLVE_SUCCESS)
+                goto binary_puzzle_solve_done;
+            continue;
+        }
         for (i = 0; i < self->size; i++) {
             for (j = 0; j < self->size; j++) {
                 if (!frame_initialized[i][j]) {
@@ -640,16 +839,16 @@ binary_puzzle_initialize_solution(BinaryPuzzle *self, bool **initialized,
                     if (cell_state == CELL_ONE || cell_state == CELL_ZERO) {
                         self->solution[i][j] = cell_state == CELL_ONE;
                         frame_initialized[i][j] = true;
+                        guess_queue_set(self, i, j);
                         updated = true;
-#ifdef DEBUG
-                        if (allowed_guesses == UINT16_MAX)
-                            binary_puzzle_print_initialization_frame(
-                                self, frame_initialized, true);
-#endif
+                        TRACE_EVENT(self->search.trace,
+                                    BINARY_PUZZLE_EVENT_ASSIGN, i, j,
+                                    cell_state == CELL_ONE);
                     } else {
                         has_remaining_cells = true;
                         if (cell_state == CELL_INVALID) {
-                            solve_status = SOLVE_REACHED_INVALID;
+                            solve_status
+                                = binary_puzzle_search_conflict(&self->search);
                             goto binary_puzzle_solve_done;
                         }
                     }
@@ -661,40 +860,88 @@ binary_puzzle_initialize_solution(BinaryPuzzle *self, bool **initialized,
     if (solve_status == SOLVE_SUCCESS && has_remaining_cells) {
         solve_status = binary_puzzle_make_probable_guess(
             self, frame_initialized, allowed_guesses);
+    } else if (solve_status == SOLVE_SUCCESS && self->excluded != NULL
+               && memcmp(*self->solution, *self->excluded,
+                         self->size * self->size * sizeof(bool))
+                      == 0) {
+        solve_status = binary_puzzle_search_conflict(&self->search);
     }
 
 binary_puzzle_solve_done:
+    guess_queue_unset_to(self, set_ct);
     free(*frame_initialized);
     free(frame_initialized);
     return solve_status;
 }
 
+static solve_status_t
+binary_puzzle_initialize_solution(BinaryPuzzle *self, bool **initialized,
+                                  uint16_t allowed_guesses) {
+    if (!guess_queue_reset(self, initialized))
+        return SOLVE_SYSTEM_ERROR;
+    return binary_puzzle_search_solution(self, initialized, allowed_guesses);
+}
+
 /**
- * Initialize binary puzzle. Return false on failure.
+ * Initialize binary puzzle with random values, starting over whenever the
+ * restart schedule of `options` says the search has gone on too long.
  */
-static bool binary_puzzle_initialize(BinaryPuzzle *self) {
+static solve_status_t
+binary_puzzle_initialize(BinaryPuzzle *self,
+                         const binary_puzzle_options_t *options) {
     solve_status_t solve_status;
     bool **initialized = (bool **)get_empty_board(self, sizeof(bool), false);
     if (initialized == NULL) {
-        return false;
+        return SOLVE_SYSTEM_ERROR;
     }
 
-    solve_status = binary_puzzle_initialize_solution(self, initialized, UINT16_MAX);
+    for (;;) {
+        self->search.conflict_ct = 0;
+        self->search.conflict_limit
+            = binary_puzzle_restart_cutoff(options, self->stats.restarts);
+        if (self->kernel != NULL) {
+            solve_status = self->kernel->solve(*self->solution, *initialized,
+                                               UINT16_MAX, &self->search);
+        } else {
+            solve_status = binary_puzzle_initialize_solution(self, initialized,
+                                                             UINT16_MAX);
+        }
+        self->stats.conflicts += self->search.conflict_ct;
+        if (solve_status != SOLVE_RESTART)
+            break;
+
+        self->stats.restarts++;
+        binary_puzzle_seed(self, binary_puzzle_restart_seed(
+                                     options->seed, self->stats.restarts));
+        TRACE_EVENT(self->search.trace, BINARY_PUZZLE_EVENT_RESTART, 0, 0,
+                    false);
+    }
+    self->search.conflict_limit = 0;
 
     free(*initialized);
     free(initialized);
     return solve_status;
 }
 
+/**
+ * Set `can_mask` to whether cell (i, j) can be hidden.
+ *
+ * Return `true` iff successful.
+ */
 static bool binary_puzzle_can_mask(BinaryPuzzle *self, size_t i, size_t j,
-                                   uint16_t allowed_guesses) {
+                                   uint16_t allowed_guesses, bool *can_mask) {
     bool **fake_initialized
         = (bool **)get_empty_board(self, sizeof(bool), false);
     bool **fake_solution = (bool **)get_empty_board(self, sizeof(bool), false);
     bool **real_solution;
+    BinaryPuzzleTrace *trace;
     size_t k, l;
     cell_state_t cell_state;
-    bool can_mask;
+    solve_status_t solve_status = SOLVE_SUCCESS;
+    if (fake_initialized == NULL || fake_solution == NULL) {
+        solve_status = SOLVE_SYSTEM_ERROR;
+        goto binary_puzzle_can_mask_done;
+    }
     for (k = 0; k < self->size; k++) {
         for (l = 0; l < self->size; l++) {
             if (self->mask[k][l]) {
@@ -710,107 +957,890 @@ static bool binary_puzzle_can_mask(BinaryPuzzle *self, size_t i, size_t j,
         = binary_puzzle_get_expected_cell_state(self, fake_initialized, i, j);
     if ((cell_state == CELL_ONE && real_solution[i][j])
         || (cell_state == CELL_ZERO && !real_solution[i][j])) {
-        can_mask = true;
+        *can_mask = true;
     } else {
         fake_initialized[i][j] = true;
         fake_solution[i][j] = !real_solution[i][j];
 
-        can_mask = binary_puzzle_initialize_solution(self, fake_initialized,
-                                                     allowed_guesses)
-                   == SOLVE_REACHED_INVALID;
+        /* only the outcome is traced, not the search behind it */
+        trace = self->search.trace;
+        self->search.trace = NULL;
+        self->stats.mask_solves++;
+        solve_status = binary_puzzle_initialize_solution(self, fake_initialized,
+                                                         allowed_guesses);
+        *can_mask = solve_status == SOLVE_REACHED_INVALID;
+        self->search.trace = trace;
     }
     self->solution = real_solution;
-    free(*fake_initialized);
-    free(fake_initialized);
-    free(*fake_solution);
-    free(fake_solution);
-    return can_mask;
+
+binary_puzzle_can_mask_done:
+    if (fake_initialized != NULL) {
+        free(*fake_initialized);
+        free(fake_initialized);
+    }
+    if (fake_solution != NULL) {
+        free(*fake_solution);
+        free(fake_solution);
+    }
+    return solve_status != SOLVE_SYSTEM_ERROR;
 }
 
-static bool
-binary_puzzle_initialize_mask(BinaryPuzzle *self,
-                              binary_puzzle_difficulty_t difficulty) {
-    const uint16_t allowed_guesses = difficulty == BINARY_PUZZLE_EASY     ? 0
+/**
+ * Set `can_mask` to whether the `cell_ct` cells listed in `cells`, as
+ * row-major indices, can all be hidden at once: with them hidden, no solution
+ * but `self->solution` is found within `allowed_guesses` nested guesses.
+ *
+ * If another solution is found, `cells` is reordered to list the cells it
+ * agrees with first, and `agree_ct` is set to how many. Otherwise it is set
+ * to `cell_ct`.
+ *
+ * Return `true` iff successful.
+ */
+static bool binary_puzzle_can_mask_all(BinaryPuzzle *self, size_t *cells,
+                                       size_t cell_ct,
+                                       uint16_t allowed_guesses,
+                                       bool *can_mask, size_t *agree_ct) {
+    bool **fake_initialized
+        = (bool **)get_empty_board(self, sizeof(bool), false);
+    bool **fake_solution = (bool **)get_empty_board(self, sizeof(bool), false);
+    bool **real_solution;
+    BinaryPuzzleTrace *trace;
+    size_t k, tmp;
+    solve_status_t solve_status = SOLVE_SUCCESS;
+    *agree_ct = cell_ct;
+    if (fake_initialized == NULL || fake_solution == NULL) {
+        solve_status = SOLVE_SYSTEM_ERROR;
+        goto binary_puzzle_can_mask_all_done;
+    }
+    for (k = 0; k < self->size * self->size; k++) {
+        if ((*self->mask)[k]) {
+            (*fake_initialized)[k] = true;
+            (*fake_solution)[k] = (*self->solution)[k];
+        }
+    }
+    for (k = 0; k < cell_ct; k++) {
+        (*fake_initialized)[cells[k]] = false;
+    }
+
+    real_solution = self->solution;
+    self->solution = fake_solution;
+    self->excluded = real_solution;
+    trace = self->search.trace;
+    self->search.trace = NULL;
+    self->stats.mask_solves++;
+    solve_status = binary_puzzle_initialize_solution(self, fake_initialized,
+                                                     allowed_guesses);
+    *can_mask = solve_status == SOLVE_REACHED_INVALID;
+    self->search.trace = trace;
+    self->excluded = NULL;
+    self->solution = real_solution;
+
+    if (solve_status == SOLVE_SUCCESS) {
+        *agree_ct = 0;
+        for (k = 0; k < cell_ct; k++) {
+            if ((*fake_solution)[cells[k]] == (*real_solution)[cells[k]]) {
+                tmp = cells[*agree_ct];
+                cells[(*agree_ct)++] = cells[k];
+                cells[k] = tmp;
+            }
+        }
+    }
+
+binary_puzzle_can_mask_all_done:
+    if (fake_initialized != NULL) {
+        free(*fake_initialized);
+        free(fake_initialized);
+    }
+    if (fake_solution != NULL) {
+        free(*fake_solution);
+        free(fake_solution);
+    }
+    return solve_status != SOLVE_SYSTEM_ERROR;
+}
+
+/**
+ * Hide whichever of the `cell_ct` cells listed in `cells` can be hidden,
+ * trying them all at once and splitting them when that fails. `known_bad`
+ * says hiding all of them is already known to fail.
+ *
+ * A failed batch whose check found another solution is split into the cells
+ * that solution agrees with and the ones it changes, at least one of which
+ * has to stay. If it changes only one, that cell stays without another
+ * solve. Otherwise the batch is split in half.
+ *
+ * Set `hidden_ct` to how many were hidden. Return `true` iff successful.
+ */
+static bool binary_puzzle_mask_bisect(BinaryPuzzle *self, size_t *cells,
+                                      size_t cell_ct, bool known_bad,
+                                      uint16_t allowed_guesses,
+                                      size_t *hidden_ct) {
+    size_t k, split_ct = cell_ct / 2, first_hidden_ct, second_hidden_ct;
+    bool can_mask = false, witnessed = false;
+
+    *hidden_ct = 0;
+    if (cell_ct == 0 || binary_puzzle_search_cancelled(&self->search)) {
+        return true;
+    }
+    if (cell_ct == 1) {
+        if (!known_bad
+            && !binary_puzzle_can_mask(self, cells[0] / self->size,
+                                       cells[0] % self->size, allowed_guesses,
+                                       &can_mask)) {
+            return false;
+        }
+    } else if (!known_bad) {
+        if (!binary_puzzle_can_mask_all(self, cells, cell_ct, allowed_guesses,
+                                        &can_mask, &k)) {
+            return false;
+        }
+        /* a solution changing every cell tells them apart no better */
+        if (k > 0 && k < cell_ct) {
+            split_ct = k;
+            witnessed = true;
+        }
+    }
+    if (can_mask) {
+        for (k = 0; k < cell_ct; k++) {
+            (*self->mask)[cells[k]] = false;
+            TRACE_EVENT(self->search.trace, BINARY_PUZZLE_EVENT_MASK_ACCEPT,
+                        cells[k] / self->size, cells[k] % self->size, false);
+        }
+        *hidden_ct = cell_ct;
+        return true;
+    }
+    if (cell_ct == 1) {
+        TRACE_EVENT(self->search.trace, BINARY_PUZZLE_EVENT_MASK_REJECT,
+                    cells[0] / self->size, cells[0] % self->size, false);
+        return true;
+    }
+
+    if (!binary_puzzle_mask_bisect(self, cells, split_ct, false,
+                                   allowed_guesses, &first_hidden_ct)) {
+        return false;
+    }
+    /*
+     * with the whole first part hidden the second part is the failed batch,
+     * and a single cell the other solution changes stays either way
+     */
+    if (!binary_puzzle_mask_bisect(
+            self, cells + split_ct, cell_ct - split_ct,
+            first_hidden_ct == split_ct
+                || (witnessed && cell_ct - split_ct == 1),
+            allowed_guesses, &second_hidden_ct)) {
+        return false;
+    }
+    *hidden_ct = first_hidden_ct + second_hidden_ct;
+    return true;
+}
+
+/**
+ * Return how many cells to test with one solve when about `accept_rate` of
+ * the cells tested lately could be hidden: the largest batch that still
+ * passes whole about half the time, or single cells once too few pass for
+ * a batch to pay for its bisection.
+ */
+static size_t mask_batch_size(double accept_rate) {
+    size_t batch_ct = 1;
+    double pass_rate = accept_rate;
+
+    if (accept_rate < MASK_BULK_MIN_RATE)
+        return 1;
+    while (batch_ct < MASK_BATCH_MAX && pass_rate * pass_rate >= 0.5) {
+        batch_ct *= 2;
+        pass_rate *= pass_rate;
+    }
+    return batch_ct;
+}
+
+/**
+ * Hide as many cells as the difficulty of `options` allows.
+ *
+ * Cells are visited in a random order. Those the rules settle outright are
+ * hidden without a solve; the rest are tested one at a time or, with
+ * `BINARY_PUZZLE_MASK_BULK`, in batches that are hidden together after one
+ * solve and bisected when that fails. Batches are sized by how many recent
+ * cells could be hidden, so they are large while nearly every cell can and
+ * single cells once about half have to stay. With `BINARY_PUZZLE_MASK_RULES`
+ * they are not tested at all. Cells `self` already hides stay hidden.
+ *
+ * Return `true` iff successful.
+ */
+static bool
+binary_puzzle_initialize_mask(BinaryPuzzle *self,
+                              const binary_puzzle_options_t *options) {
+    const binary_puzzle_difficulty_t difficulty = options->difficulty;
+    const uint16_t allowed_guesses = difficulty == BINARY_PUZZLE_EASY     ? 0
                                      : difficulty == BINARY_PUZZLE_MEDIUM ? 3
                                                                           : 8;
-    size_t i, j;
-    bool **contenders = (bool **)get_empty_board(self, sizeof(bool), true);
-    size_t contender_ct = self->size * self->size;
-    size_t contender_idx;
-    if (contenders == NULL) {
-        return false;
+    size_t cell_ct = self->size * self->size;
+    size_t *cells;
+    size_t *pending, pending_ct, hidden_ct, batch_ct = 1;
+    size_t i, j, k, l, swap_idx, tmp;
+    cell_state_t cell_state;
+    /* share of the cells tested lately that could be hidden */
+    double accept_rate = 1;
+
+    if (self->kernel != NULL
+        && options->mask_strategy != BINARY_PUZZLE_MASK_RULES) {
+        self->search.search_ct = 0;
+        self->kernel->initialize_mask(*self->solution, *self->mask,
+                                      allowed_guesses, &self->search);
+        self->stats.mask_solves += self->search.search_ct;
+        return true;
     }
 
-    while (contender_ct > 0) {
-    apply_next_mask:
-        contender_idx = (1.0 * rand() / RAND_MAX) * contender_ct;
-        for (i = 0; i < self->size; i++) {
-            for (j = 0; j < self->size; j++) {
-                if (contenders[i][j]) {
-                    if (contender_idx == 0) {
-                        contenders[i][j] = false;
-                        contender_ct--;
-
-                        if (!binary_puzzle_can_mask(self, i, j,
-                                                    allowed_guesses)) {
-                            goto apply_next_mask;
-                        }
+    cells = malloc(cell_ct * sizeof(size_t));
+    if (cells == NULL) {
+        return false;
+    }
+    for (k = 0; k < cell_ct; k++) {
+        cells[k] = k;
+    }
+    for (k = cell_ct; k > 1; k--) {
+        swap_idx = binary_puzzle_random(self) * k;
+        tmp = cells[k - 1];
+        cells[k - 1] = cells[swap_idx];
+        cells[swap_idx] = tmp;
+    }
 
-                        self->mask[i][j] = false;
-#ifdef DEBUG
-                        binary_puzzle_print_initialization_frame(self, NULL,
-                                                                 true);
-#endif
-                        goto apply_next_mask;
-                    }
-                    contender_idx--;
-                }
+    k = 0;
+    while (k < cell_ct && !binary_puzzle_search_cancelled(&self->search)) {
+        if (options->mask_strategy == BINARY_PUZZLE_MASK_BULK)
+            batch_ct = mask_batch_size(accept_rate);
+        /* hide cells the rules settle outright, queueing the rest to test */
+        pending = cells + k;
+        pending_ct = 0;
+        while (k < cell_ct && pending_ct < batch_ct) {
+            i = cells[k] / self->size;
+            j = cells[k] % self->size;
+            k++;
+            /* hidden by an earlier, easier pass */
+            if (!self->mask[i][j])
+                continue;
+            self->mask[i][j] = false;
+            cell_state = binary_puzzle_get_expected_cell_state(self, self->mask,
+                                                               i, j);
+            if (cell_state != (self->solution[i][j] ? CELL_ONE : CELL_ZERO)) {
+                self->mask[i][j] = true;
+                pending[pending_ct++] = i * self->size + j;
+            } else {
+                TRACE_EVENT(self->search.trace,
+                            BINARY_PUZZLE_EVENT_MASK_ACCEPT, i, j, false);
             }
         }
+
+        if (options->mask_strategy == BINARY_PUZZLE_MASK_RULES)
+            continue;
+        if (!binary_puzzle_mask_bisect(self, pending, pending_ct, false,
+                                       allowed_guesses, &hidden_ct)) {
+            free(cells);
+            return false;
+        }
+        for (l = 0; l < pending_ct; l++) {
+            accept_rate += ((l < hidden_ct) - accept_rate) / MASK_RATE_WINDOW;
+        }
     }
 
-    free(*contenders);
-    free(contenders);
+    free(cells);
     return true;
 }
 
-BinaryPuzzle *binary_puzzle_create(uint8_t size,
-                                   binary_puzzle_difficulty_t difficulty) {
-    BinaryPuzzle *new = NULL;
-
-    if (size == 0 || size % 2 != 0) {
-        report_logic_error(
-            "cannot initialize binary puzzle with 0 or odd size");
-        exit(1);
+static binary_puzzle_status_t status_from_solve_status(solve_status_t status) {
+    switch (status) {
+    case SOLVE_SUCCESS:
+        return BINARY_PUZZLE_OK;
+    case SOLVE_OUT_OF_GUESSES:
+        return BINARY_PUZZLE_ERR_OUT_OF_GUESSES;
+    case SOLVE_REACHED_INVALID:
+        return BINARY_PUZZLE_ERR_UNSOLVABLE;
+    case SOLVE_CANCELLED:
+        return BINARY_PUZZLE_ERR_CANCELLED;
+    default:
+        return BINARY_PUZZLE_ERR_NO_MEMORY;
     }
+}
 
-    new = calloc(1, sizeof(BinaryPuzzle));
+/**
+ * Allocate a `BinaryPuzzle` with every cell given.
+ *
+ * Return `NULL` on allocation failure.
+ */
+static BinaryPuzzle *binary_puzzle_new(uint8_t size) {
+    BinaryPuzzle *new = calloc(1, sizeof(BinaryPuzzle));
     if (new == NULL)
-        goto binary_puzzle_create_fail;
+        return NULL;
 
     new->size = size;
     new->solution = (bool **)get_empty_board(new, sizeof(bool), false);
-    if (new->solution == NULL)
-        goto binary_puzzle_create_fail;
-
     new->mask = (bool **)get_empty_board(new, sizeof(bool), true);
-    if (new->mask == NULL)
-        goto binary_puzzle_create_fail;
+    if (new->solution == NULL || new->mask == NULL) {
+        binary_puzzle_destroy(new);
+        return NULL;
+    }
+    new->kernel = binary_puzzle_kernel_find(size);
+    return new;
+}
+
+void binary_puzzle_options_init(binary_puzzle_options_t *options, uint8_t size,
+                                binary_puzzle_difficulty_t difficulty) {
+    memset(options, 0, sizeof(binary_puzzle_options_t));
+    options->size = size;
+    options->difficulty = difficulty;
+    options->restart_schedule = BINARY_PUZZLE_RESTART_LUBY;
+    options->restart_base = 32;
+    options->mask_strategy = BINARY_PUZZLE_MASK_BULK;
+}
 
-    if (binary_puzzle_initialize(new) != SOLVE_SUCCESS) {
-        goto binary_puzzle_create_fail;
+const char *binary_puzzle_status_string(binary_puzzle_status_t status) {
+    switch (status) {
+    case BINARY_PUZZLE_OK:
+        return "success";
+    case BINARY_PUZZLE_ERR_INVALID_ARGUMENT:
+        return "invalid argument";
+    case BINARY_PUZZLE_ERR_NO_MEMORY:
+        return "memory allocation failure";
+    case BINARY_PUZZLE_ERR_UNSOLVABLE:
+        return "puzzle has no solution";
+    case BINARY_PUZZLE_ERR_OUT_OF_GUESSES:
+        return "puzzle needs more guesses than allowed";
+    case BINARY_PUZZLE_ERR_IO:
+        return "input/output error";
+    case BINARY_PUZZLE_ERR_CANCELLED:
+        return "generation was cancelled";
+    case BINARY_PUZZLE_ERR_EXHAUSTED:
+        return "no puzzle left that is not a duplicate";
+    case BINARY_PUZZLE_ERR_TIMED_OUT:
+        return "ran out of time";
+    case BINARY_PUZZLE_TRUNCATED:
+        return "ran out of time, so fewer cells are hidden";
     }
+    return "unknown status";
+}
 
-    if (!binary_puzzle_initialize_mask(new, difficulty)) {
-        goto binary_puzzle_create_fail;
+binary_puzzle_status_t
+binary_puzzle_generate(const binary_puzzle_options_t *options,
+                       BinaryPuzzle **out) {
+    if (options->portfolio_threads > 1) {
+        return binary_puzzle_generate_portfolio(options, out);
     }
+    return binary_puzzle_generate_cancellable(options, NULL, out);
+}
 
-    return new;
+/**
+ * Make the searches of `self` stop when `cancelled` (which may be `NULL`) or
+ * the token in `options` is set, or its time budget, counted from now, runs
+ * out.
+ */
+static void binary_puzzle_limit_search(BinaryPuzzle *self,
+                                       const binary_puzzle_options_t *options,
+                                       const int *cancelled) {
+    self->search.cancelled = cancelled;
+    self->search.cancel = options->cancel;
+    self->search.deadline_us
+        = options->time_budget_ms == 0
+              ? 0
+              : monotonic_us() + (uint64_t)options->time_budget_ms * 1000;
+    self->search.timed_out = false;
+}
 
-binary_puzzle_create_fail:
-    report_system_error(FILENAME ": failure to initialize");
-    binary_puzzle_destroy(new);
-    return NULL;
+/**
+ * Lift the limits set by `binary_puzzle_limit_search`, returning what became
+ * of a generation of `self` that ended with `status`: cancelled, out of time,
+ * or truncated if time ran out while hiding cells.
+ */
+static binary_puzzle_status_t
+binary_puzzle_unlimit_search(BinaryPuzzle *self,
+                             binary_puzzle_status_t status) {
+    /* only a deadline passed during the search counts */
+    self->search.deadline_us = 0;
+    if (self->search.timed_out) {
+        if (status == BINARY_PUZZLE_ERR_CANCELLED) {
+            status = BINARY_PUZZLE_ERR_TIMED_OUT;
+        } else if (status == BINARY_PUZZLE_OK) {
+            status = BINARY_PUZZLE_TRUNCATED;
+        }
+    } else if (status == BINARY_PUZZLE_OK
+               && binary_puzzle_search_cancelled(&self->search)) {
+        status = BINARY_PUZZLE_ERR_CANCELLED;
+    }
+    self->search.cancelled = NULL;
+    self->search.cancel = NULL;
+    self->search.timed_out = false;
+    return status;
+}
+
+/**
+ * Share the propagation rounds of `self` between
+ * `options->propagation_threads` threads, if more than 1 and `self` has no
+ * kernel.
+ *
+ * Return `true` iff successful.
+ */
+static bool
+binary_puzzle_start_propagation(BinaryPuzzle *self,
+                                const binary_puzzle_options_t *options) {
+    if (options->propagation_threads <= 1 || self->kernel != NULL)
+        return true;
+    self->deduced = malloc((size_t)self->size * self->size
+                           * sizeof(cell_state_t));
+    if (self->deduced == NULL)
+        return false;
+    self->pool = binary_puzzle_pool_create(options->propagation_threads);
+    return self->pool != NULL;
+}
+
+/**
+ * Stop the threads started by `binary_puzzle_start_propagation`, so `self`
+ * propagates serially again.
+ */
+static void binary_puzzle_stop_propagation(BinaryPuzzle *self) {
+    binary_puzzle_pool_destroy(self->pool);
+    self->pool = NULL;
+    free(self->deduced);
+    self->deduced = NULL;
+}
+
+binary_puzzle_status_t
+binary_puzzle_generate_cancellable(const binary_puzzle_options_t *options,
+                                   const int *cancelled, BinaryPuzzle **out) {
+    BinaryPuzzle *new;
+    binary_puzzle_status_t status;
+    struct timespec start;
+
+    *out = NULL;
+    if (options->size == 0 || options->size % 2 != 0
+        || options->difficulty > BINARY_PUZZLE_HARD) {
+        return BINARY_PUZZLE_ERR_INVALID_ARGUMENT;
+    }
+
+    new = binary_puzzle_new(options->size);
+    if (new == NULL)
+        return BINARY_PUZZLE_ERR_NO_MEMORY;
+    binary_puzzle_seed(new, options->seed);
+    binary_puzzle_limit_search(new, options, cancelled);
+    if (!binary_puzzle_start_propagation(new, options)) {
+        binary_puzzle_destroy(new);
+        return BINARY_PUZZLE_ERR_NO_MEMORY;
+    }
+    if (options->trace != NULL) {
+        binary_puzzle_trace_begin(options->trace, options->size);
+        new->search.trace = options->trace;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    status = status_from_solve_status(binary_puzzle_initialize(new, options));
+    new->stats.solution_us = elapsed_us(&start);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (status == BINARY_PUZZLE_OK
+        && !binary_puzzle_initialize_mask(new, options))
+        status = BINARY_PUZZLE_ERR_NO_MEMORY;
+    new->stats.mask_us = elapsed_us(&start);
+    binary_puzzle_stop_propagation(new);
+    status = binary_puzzle_unlimit_search(new, status);
+    new->search.trace = NULL;
+    if (status != BINARY_PUZZLE_OK && status != BINARY_PUZZLE_TRUNCATED) {
+        binary_puzzle_destroy(new);
+        return status;
+    }
+
+    *out = new;
+    return status;
+}
+
+binary_puzzle_status_t
+binary_puzzle_mask_solution(const binary_puzzle_options_t *options,
+                            const bool *solution,
+                            const binary_puzzle_stats_t *stats,
+                            BinaryPuzzle **out) {
+    BinaryPuzzle *new;
+    struct timespec start;
+    size_t i, j;
+
+    *out = NULL;
+    if (options->size == 0 || options->size % 2 != 0
+        || options->difficulty > BINARY_PUZZLE_HARD) {
+        return BINARY_PUZZLE_ERR_INVALID_ARGUMENT;
+    }
+
+    new = binary_puzzle_new(options->size);
+    if (new == NULL)
+        return BINARY_PUZZLE_ERR_NO_MEMORY;
+    binary_puzzle_seed(new, options->seed);
+    new->stats = *stats;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    for (i = 0; i < new->size; i++) {
+        for (j = 0; j < new->size; j++) {
+            new->solution[i][j] = solution[i * new->size + j];
+        }
+    }
+
+    if (!binary_puzzle_start_propagation(new, options)
+        || !binary_puzzle_initialize_mask(new, options)) {
+        binary_puzzle_destroy(new);
+        return BINARY_PUZZLE_ERR_NO_MEMORY;
+    }
+    binary_puzzle_stop_propagation(new);
+    new->stats.mask_us = elapsed_us(&start);
+
+    *out = new;
+    return BINARY_PUZZLE_OK;
+}
+
+binary_puzzle_status_t
+binary_puzzle_harden(const BinaryPuzzle *self,
+                     const binary_puzzle_options_t *options,
+                     BinaryPuzzle **out) {
+    const size_t cell_ct = (size_t)self->size * self->size;
+    BinaryPuzzle *new;
+    binary_puzzle_status_t status = BINARY_PUZZLE_OK;
+    struct timespec start;
+
+    *out = NULL;
+    if (options->size != self->size
+        || options->difficulty > BINARY_PUZZLE_HARD) {
+        return BINARY_PUZZLE_ERR_INVALID_ARGUMENT;
+    }
+
+    new = binary_puzzle_new(self->size);
+    if (new == NULL)
+        return BINARY_PUZZLE_ERR_NO_MEMORY;
+    binary_puzzle_seed(new, options->seed);
+    binary_puzzle_limit_search(new, options, NULL);
+    new->stats = self->stats;
+    memcpy(*new->solution, *self->solution, cell_ct * sizeof(bool));
+    memcpy(*new->mask, *self->mask, cell_ct * sizeof(bool));
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (!binary_puzzle_start_propagation(new, options)
+        || !binary_puzzle_initialize_mask(new, options))
+        status = BINARY_PUZZLE_ERR_NO_MEMORY;
+    binary_puzzle_stop_propagation(new);
+    new->stats.mask_us += elapsed_us(&start);
+    status = binary_puzzle_unlimit_search(new, status);
+    if (status != BINARY_PUZZLE_OK && status != BINARY_PUZZLE_TRUNCATED) {
+        binary_puzzle_destroy(new);
+        return status;
+    }
+
+    *out = new;
+    return status;
+}
+
+binary_puzzle_status_t binary_puzzle_parse(uint8_t size, const char *cells,
+                                           BinaryPuzzle **out) {
+    BinaryPuzzle *new;
+    size_t i, j;
+
+    *out = NULL;
+    if (size == 0 || size % 2 != 0 || strlen(cells) != (size_t)size * size) {
+        return BINARY_PUZZLE_ERR_INVALID_ARGUMENT;
+    }
+
+    new = binary_puzzle_new(size);
+    if (new == NULL)
+        return BINARY_PUZZLE_ERR_NO_MEMORY;
+    binary_puzzle_seed(new, 0);
+
+    for (i = 0; i < size; i++) {
+        for (j = 0; j < size; j++) {
+            switch (cells[i * size + j]) {
+            case '0':
+                break;
+            case '1':
+                new->solution[i][j] = true;
+                break;
+            default:
+                new->mask[i][j] = false;
+                break;
+            }
+        }
+    }
+
+    *out = new;
+    return BINARY_PUZZLE_OK;
+}
+
+/**
+ * Return `true` iff the complete board of `self` follows every rule, given
+ * cells included.
+ */
+static bool binary_puzzle_is_valid(const BinaryPuzzle *self) {
+    size_t i, j, k, row_ones, col_ones;
+    bool row_differs, col_differs;
+
+    for (i = 0; i < self->size; i++) {
+        row_ones = col_ones = 0;
+        for (j = 0; j < self->size; j++) {
+            row_ones += self->solution[i][j];
+            col_ones += self->solution[j][i];
+            if (j >= 2
+                && self->solution[i][j] == self->solution[i][j - 1]
+                && self->solution[i][j] == self->solution[i][j - 2])
+                return false;
+            if (j >= 2
+                && self->solution[j][i] == self->solution[j - 1][i]
+                && self->solution[j][i] == self->solution[j - 2][i])
+                return false;
+        }
+        if (2 * row_ones != self->size || 2 * col_ones != self->size)
+            return false;
+        for (k = 0; k < i; k++) {
+            row_differs = col_differs = false;
+            for (j = 0; j < self->size; j++) {
+                row_differs |= self->solution[i][j] != self->solution[k][j];
+                col_differs |= self->solution[j][i] != self->solution[j][k];
+            }
+            if (!row_differs || !col_differs)
+                return false;
+        }
+    }
+    return true;
+}
+
+binary_puzzle_status_t binary_puzzle_solve(BinaryPuzzle *self,
+                                           uint16_t allowed_guesses) {
+    solve_status_t solve_status;
+    size_t i, j;
+    bool **initialized = (bool **)get_empty_board(self, sizeof(bool), false);
+    if (initialized == NULL) {
+        return BINARY_PUZZLE_ERR_NO_MEMORY;
+    }
+
+    for (i = 0; i < self->size; i++) {
+        for (j = 0; j < self->size; j++) {
+            initialized[i][j] = self->mask[i][j];
+        }
+    }
+    self->search.conflict_ct = 0;
+    if (self->kernel != NULL) {
+        solve_status = self->kernel->solve(*self->solution, *initialized,
+                                           allowed_guesses, &self->search);
+    } else {
+        solve_status = binary_puzzle_initialize_solution(self, initialized,
+                                                         allowed_guesses);
+    }
+    self->stats.conflicts = self->search.conflict_ct;
+    /* the search only checks the cells it fills in against the givens */
+    if (solve_status == SOLVE_SUCCESS && !binary_puzzle_is_valid(self))
+        solve_status = SOLVE_REACHED_INVALID;
+
+    free(*initialized);
+    free(initialized);
+    return status_from_solve_status(solve_status);
+}
+
+binary_puzzle_status_t binary_puzzle_check_unique(BinaryPuzzle *self,
+                                                  bool *unique) {
+    solve_status_t solve_status;
+    bool **other = (bool **)get_empty_board(self, sizeof(bool), false);
+    bool **real_solution;
+    size_t k;
+
+    if (other == NULL) {
+        return BINARY_PUZZLE_ERR_NO_MEMORY;
+    }
+    for (k = 0; k < self->size * self->size; k++) {
+        if ((*self->mask)[k])
+            (*other)[k] = (*self->solution)[k];
+    }
+
+    /* search for any solution but the one found */
+    real_solution = self->solution;
+    self->solution = other;
+    self->excluded = real_solution;
+    self->search.conflict_ct = 0;
+    solve_status
+        = binary_puzzle_initialize_solution(self, self->mask, UINT16_MAX);
+    if (solve_status == SOLVE_SUCCESS && !binary_puzzle_is_valid(self))
+        solve_status = SOLVE_REACHED_INVALID;
+    self->stats.conflicts += self->search.conflict_ct;
+    self->excluded = NULL;
+    self->solution = real_solution;
+
+    free(*other);
+    free(other);
+    *unique = solve_status == SOLVE_REACHED_INVALID;
+    return solve_status == SOLVE_SYSTEM_ERROR ? BINARY_PUZZLE_ERR_NO_MEMORY
+                                              : BINARY_PUZZLE_OK;
+}
+
+void binary_puzzle_write_cells(const BinaryPuzzle *self, bool reveal,
+                               char *out) {
+    size_t i, j;
+    for (i = 0; i < self->size; i++) {
+        for (j = 0; j < self->size; j++) {
+            if (reveal || self->mask[i][j]) {
+                *out++ = self->solution[i][j] ? '1' : '0';
+            } else {
+                *out++ = '.';
+            }
+        }
+    }
+    *out = '\0';
+}
+
+binary_puzzle_status_t binary_puzzle_transform(const BinaryPuzzle *self,
+                                               uint8_t symmetry,
+                                               BinaryPuzzle **out) {
+    const size_t last = self->size - 1;
+    const bool complement = symmetry & 8;
+    BinaryPuzzle *new;
+    size_t i, j, a, b, tmp;
+
+    *out = NULL;
+    if (symmetry >= BINARY_PUZZLE_SYMMETRY_COUNT)
+        return BINARY_PUZZLE_ERR_INVALID_ARGUMENT;
+    new = binary_puzzle_new(self->size);
+    if (new == NULL)
+        return BINARY_PUZZLE_ERR_NO_MEMORY;
+    new->stats = self->stats;
+
+    for (i = 0; i < self->size; i++) {
+        for (j = 0; j < self->size; j++) {
+            a = symmetry & 2 ? last - i : i;
+            b = symmetry & 4 ? last - j : j;
+            if (symmetry & 1) {
+                tmp = a;
+                a = b;
+                b = tmp;
+            }
+            new->solution[i][j] = self->solution[a][b] != complement;
+            new->mask[i][j] = self->mask[a][b];
+        }
+    }
+
+    *out = new;
+    return BINARY_PUZZLE_OK;
+}
+
+/**
+ * Return `true` iff `self` and `other` have the same solution and hidden
+ * cells.
+ */
+static bool binary_puzzle_equals(const BinaryPuzzle *self,
+                                 const BinaryPuzzle *other) {
+    const size_t cell_ct = (size_t)self->size * self->size;
+    return memcmp(*self->solution, *other->solution, cell_ct * sizeof(bool))
+               == 0
+           && memcmp(*self->mask, *other->mask, cell_ct * sizeof(bool)) == 0;
+}
+
+binary_puzzle_status_t binary_puzzle_variants(const BinaryPuzzle *self,
+                                              BinaryPuzzle **out,
+                                              size_t *count) {
+    binary_puzzle_status_t status;
+    BinaryPuzzle *variant;
+    size_t k;
+    uint8_t symmetry;
+
+    *count = 0;
+    for (symmetry = 0; symmetry < BINARY_PUZZLE_SYMMETRY_COUNT; symmetry++) {
+        status = binary_puzzle_transform(self, symmetry, &variant);
+        if (status != BINARY_PUZZLE_OK) {
+            for (k = 0; k < *count; k++) {
+                binary_puzzle_destroy(out[k]);
+                out[k] = NULL;
+            }
+            *count = 0;
+            return status;
+        }
+        /* symmetric puzzles map onto themselves under some symmetries */
+        for (k = 0; k < *count && !binary_puzzle_equals(out[k], variant); k++)
+            ;
+        if (k < *count) {
+            binary_puzzle_destroy(variant);
+        } else {
+            out[(*count)++] = variant;
+        }
+    }
+    return BINARY_PUZZLE_OK;
+}
+
+/**
+ * Pack the cells of `self` under `symmetry` into `out`: solution bits, then
+ * mask bits, both row-major with the first cell in the top bit.
+ */
+static void binary_puzzle_pack(const BinaryPuzzle *self, uint8_t symmetry,
+                               uint8_t *out) {
+    const size_t last = self->size - 1;
+    const size_t half = BINARY_PUZZLE_CANONICAL_BYTES(self->size) / 2;
+    const bool complement = symmetry & 8;
+    size_t i, j, a, b, tmp, k = 0;
+
+    memset(out, 0, 2 * half);
+    for (i = 0; i < self->size; i++) {
+        for (j = 0; j < self->size; j++, k++) {
+            a = symmetry & 2 ? last - i : i;
+            b = symmetry & 4 ? last - j : j;
+            if (symmetry & 1) {
+                tmp = a;
+                a = b;
+                b = tmp;
+            }
+            if (self->solution[a][b] != complement)
+                out[k / 8] |= 0x80 >> k % 8;
+            if (self->mask[a][b])
+                out[half + k / 8] |= 0x80 >> k % 8;
+        }
+    }
+}
+
+void binary_puzzle_write_canonical(const BinaryPuzzle *self, uint8_t *out) {
+    const size_t byte_ct = BINARY_PUZZLE_CANONICAL_BYTES(self->size);
+    uint8_t candidate[BINARY_PUZZLE_CANONICAL_BYTES(UINT8_MAX)];
+    uint8_t symmetry;
+
+    binary_puzzle_pack(self, 0, out);
+    for (symmetry = 1; symmetry < BINARY_PUZZLE_SYMMETRY_COUNT; symmetry++) {
+        binary_puzzle_pack(self, symmetry, candidate);
+        if (memcmp(candidate, out, byte_ct) < 0)
+            memcpy(out, candidate, byte_ct);
+    }
+}
+
+uint64_t binary_puzzle_canonical_hash(const BinaryPuzzle *self) {
+    uint8_t canonical[BINARY_PUZZLE_CANONICAL_BYTES(UINT8_MAX)];
+    /* FNV-1a */
+    uint64_t hash = 0xcbf29ce484222325U;
+    size_t k;
+
+    binary_puzzle_write_canonical(self, canonical);
+    for (k = 0; k < BINARY_PUZZLE_CANONICAL_BYTES(self->size); k++) {
+        hash ^= canonical[k];
+        hash *= 0x100000001b3U;
+    }
+    return hash;
+}
+
+void binary_puzzle_get_stats(const BinaryPuzzle *self,
+                             binary_puzzle_stats_t *stats) {
+    *stats = self->stats;
+}
+
+uint8_t binary_puzzle_get_size(const BinaryPuzzle *self) { return self->size; }
+
+bool binary_puzzle_get_solution(const BinaryPuzzle *self, uint8_t i,
+                                uint8_t j) {
+    return self->solution[i][j];
+}
+
+bool binary_puzzle_is_given(const BinaryPuzzle *self, uint8_t i, uint8_t j) {
+    return self->mask[i][j];
+}
+
+BinaryPuzzle *binary_puzzle_create(uint8_t size,
+                                   binary_puzzle_difficulty_t difficulty) {
+    BinaryPuzzle *new;
+    binary_puzzle_options_t options;
+
+    binary_puzzle_options_init(&options, size, difficulty);
+    options.seed = rand();
+    if (size >= PORTFOLIO_MIN_SIZE) {
+        options.portfolio_threads = binary_puzzle_portfolio_default_threads();
+    }
+    binary_puzzle_generate(&options, &new);
+    return new;
 }
 
 void binary_puzzle_destroy(BinaryPuzzle *self) {
@@ -823,10 +1853,8 @@ void binary_puzzle_destroy(BinaryPuzzle *self) {
             free(*self->mask);
             free(self->mask);
         }
-        if (self->user_guesses != NULL) {
-            free(*self->user_guesses);
-            free(self->user_guesses);
-        }
+        guess_queue_free(&self->queue);
+        binary_puzzle_stop_propagation(self);
         free(self);
     }
 }
@@ -0,0 +1,63 @@
+#include "binary_puzzle_internal.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+#define KERNEL_SIZE 6
+#define KERNEL_WORD uint8_t
+#define KERNEL_FN(name) kernel6_##name
+#include "kernel_template.h"
+#undef KERNEL_SIZE
+#undef KERNEL_WORD
+#undef KERNEL_FN
+
+#define KERNEL_SIZE 8
+#define KERNEL_WORD uint8_t
+#define KERNEL_FN(name) kernel8_##name
+#include "kernel_template.h"
+#undef KERNEL_SIZE
+#undef KERNEL_WORD
+#undef KERNEL_FN
+
+#define KERNEL_SIZE 10
+#define KERNEL_WORD uint16_t
+#define KERNEL_FN(name) kernel10_##name
+#include "kernel_template.h"
+#undef KERNEL_SIZE
+#undef KERNEL_WORD
+#undef KERNEL_FN
+
+#define KERNEL_SIZE 12
+#define KERNEL_WORD uint16_t
+#define KERNEL_FN(name) kernel12_##name
+#include "kernel_template.h"
+#undef KERNEL_SIZE
+#undef KERNEL_WORD
+#undef KERNEL_FN
+
+#define KERNEL_SIZE 14
+#define KERNEL_WORD uint16_t
+#define KERNEL_FN(name) kernel14_##name
+#include "kernel_template.h"
+#undef KERNEL_SIZE
+#undef KERNEL_WORD
+#undef KERNEL_FN
+
+/* the sizes nearly all traffic asks for */
+static const BinaryPuzzleKernel kernels[] = {
+    {6, kernel6_solve, kernel6_initialize_mask},
+    {8, kernel8_solve, kernel8_initialize_mask},
+    {10, kernel10_solve, kernel10_initialize_mask},
+    {12, kernel12_solve, kernel12_initialize_mask},
+    {14, kernel14_solve, kernel14_initialize_mask},
+};
+
+const BinaryPuzzleKernel *binary_puzzle_kernel_find(uint8_t size) {
+    size_t i;
+    for (i = 0; i < sizeof(kernels) / sizeof(kernels[0]); i++) {
+        if (kernels[i].size == size) {
+            return &kernels[i];
+        }
+    }
+    return NULL;
+}
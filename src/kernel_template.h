@@ -0,0 +1,331 @@
+/*
+ * Solver and masker for boards of one fixed size, instantiated once per size
+ * by kernel.c. The includer defines:
+ *
+ * KERNEL_SIZE     side length of the board
+ * KERNEL_WORD     unsigned type with at least KERNEL_SIZE bits
+ * KERNEL_FN(x)    name of the instantiation of `x`
+ *
+ * Every row and column is a word whose bit `k` is the `k`th cell of that
+ * line, so all three rules are checks on single words. With the side length
+ * known at compile time the loops over lines unroll completely.
+ */
+
+#define KERNEL_FULL ((KERNEL_WORD)((1U << KERNEL_SIZE) - 1))
+#define KERNEL_HALF (KERNEL_SIZE / 2)
+#define KERNEL_BOARD KERNEL_FN(board_t)
+
+typedef struct {
+    KERNEL_WORD row_ones[KERNEL_SIZE];
+    KERNEL_WORD row_zeros[KERNEL_SIZE];
+    KERNEL_WORD col_ones[KERNEL_SIZE];
+    KERNEL_WORD col_zeros[KERNEL_SIZE];
+} KERNEL_BOARD;
+
+static void KERNEL_FN(set)(KERNEL_BOARD *board, uint8_t i, uint8_t j,
+                           bool value) {
+    if (value) {
+        board->row_ones[i] |= (KERNEL_WORD)(1U << j);
+        board->col_ones[j] |= (KERNEL_WORD)(1U << i);
+    } else {
+        board->row_zeros[i] |= (KERNEL_WORD)(1U << j);
+        board->col_zeros[j] |= (KERNEL_WORD)(1U << i);
+    }
+}
+
+static void KERNEL_FN(unset)(KERNEL_BOARD *board, uint8_t i, uint8_t j) {
+    board->row_ones[i] &= (KERNEL_WORD)~(1U << j);
+    board->row_zeros[i] &= (KERNEL_WORD)~(1U << j);
+    board->col_ones[j] &= (KERNEL_WORD)~(1U << i);
+    board->col_zeros[j] &= (KERNEL_WORD)~(1U << i);
+}
+
+/**
+ * Find the unknown cells of a line forced by the 3-in-a-row and evenness
+ * rules.
+ *
+ * Return `false` if the line already breaks a rule or a cell is forced both
+ * ways.
+ */
+static bool KERNEL_FN(line_forced)(KERNEL_WORD ones, KERNEL_WORD zeros,
+                                   KERNEL_WORD *forced_zero,
+                                   KERNEL_WORD *forced_one) {
+    const unsigned unknown = KERNEL_FULL & ~(ones | zeros);
+    const unsigned one_pairs = ones & (ones >> 1);
+    const unsigned zero_pairs = zeros & (zeros >> 1);
+    const int one_ct = __builtin_popcount(ones);
+    const int zero_ct = __builtin_popcount(zeros);
+    unsigned zero_mask, one_mask;
+
+    if ((one_pairs & (ones >> 2)) != 0 || (zero_pairs & (zeros >> 2)) != 0
+        || one_ct > KERNEL_HALF || zero_ct > KERNEL_HALF) {
+        return false;
+    }
+
+    zero_mask = (one_pairs >> 1) | (one_pairs << 2)
+                | ((ones & (ones >> 2)) << 1);
+    one_mask = (zero_pairs >> 1) | (zero_pairs << 2)
+               | ((zeros & (zeros >> 2)) << 1);
+    if (one_ct == KERNEL_HALF) {
+        zero_mask = KERNEL_FULL;
+    }
+    if (zero_ct == KERNEL_HALF) {
+        one_mask = KERNEL_FULL;
+    }
+    zero_mask &= unknown;
+    one_mask &= unknown;
+
+    *forced_zero = (KERNEL_WORD)zero_mask;
+    *forced_one = (KERNEL_WORD)one_mask;
+    return (zero_mask & one_mask) == 0;
+}
+
+/**
+ * Return `false` if two complete lines are equal.
+ */
+static bool KERNEL_FN(lines_unique)(const KERNEL_WORD *ones,
+                                    const KERNEL_WORD *zeros) {
+    uint8_t k, l;
+#pragma GCC unroll 16
+    for (k = 0; k < KERNEL_SIZE; k++) {
+        if ((ones[k] | zeros[k]) != KERNEL_FULL)
+            continue;
+        for (l = k + 1; l < KERNEL_SIZE; l++) {
+            if (ones[l] == ones[k] && (ones[l] | zeros[l]) == KERNEL_FULL) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * Fill in every cell the rules force.
+ */
+static solve_status_t KERNEL_FN(propagate)(KERNEL_BOARD *board,
+                                           SearchContext *context) {
+    KERNEL_WORD forced_zero, forced_one;
+    unsigned bits;
+    uint8_t k, l;
+    bool updated;
+
+    do {
+        updated = false;
+#pragma GCC unroll 16
+        for (k = 0; k < KERNEL_SIZE; k++) {
+            if (!KERNEL_FN(line_forced)(board->row_ones[k],
+                                        board->row_zeros[k], &forced_zero,
+                                        &forced_one)) {
+                return SOLVE_REACHED_INVALID;
+            }
+            for (bits = forced_zero | forced_one; bits != 0;
+                 bits &= bits - 1) {
+                l = __builtin_ctz(bits);
+                KERNEL_FN(set)(board, k, l, forced_one >> l & 1);
+                TRACE_EVENT(context->trace, BINARY_PUZZLE_EVENT_ASSIGN, k, l,
+                            forced_one >> l & 1);
+                updated = true;
+            }
+        }
+#pragma GCC unroll 16
+        for (k = 0; k < KERNEL_SIZE; k++) {
+            if (!KERNEL_FN(line_forced)(board->col_ones[k],
+                                        board->col_zeros[k], &forced_zero,
+                                        &forced_one)) {
+                return SOLVE_REACHED_INVALID;
+            }
+            for (bits = forced_zero | forced_one; bits != 0;
+                 bits &= bits - 1) {
+                l = __builtin_ctz(bits);
+                KERNEL_FN(set)(board, l, k, forced_one >> l & 1);
+                TRACE_EVENT(context->trace, BINARY_PUZZLE_EVENT_ASSIGN, l, k,
+                            forced_one >> l & 1);
+                updated = true;
+            }
+        }
+    } while (updated);
+
+    if (!KERNEL_FN(lines_unique)(board->row_ones, board->row_zeros)
+        || !KERNEL_FN(lines_unique)(board->col_ones, board->col_zeros)) {
+        return SOLVE_REACHED_INVALID;
+    }
+    return SOLVE_SUCCESS;
+}
+
+/**
+ * Propagate, then guess the most one-sided unknown cell like
+ * `binary_puzzle_make_probable_guess` and recurse on both values.
+ */
+static solve_status_t KERNEL_FN(search)(KERNEL_BOARD *board,
+                                        uint16_t allowed_guesses,
+                                        SearchContext *context) {
+    KERNEL_BOARD saved;
+    solve_status_t solve_status;
+    uint8_t row_ones_needed, row_zeroes_needed;
+    uint16_t one_straws, zero_straws;
+    float one_probability, dramaticity;
+    float most_dramatic_one_probability = 0.5f, most_dramaticity = 0;
+    uint8_t i, j, most_dramatic_i = 0, most_dramatic_j = 0;
+    bool contender_found = false, value;
+
+    solve_status = KERNEL_FN(propagate)(board, context);
+    if (solve_status == SOLVE_REACHED_INVALID)
+        return binary_puzzle_search_conflict(context);
+
+    for (i = 0; i < KERNEL_SIZE; i++) {
+        row_ones_needed = KERNEL_HALF - __builtin_popcount(board->row_ones[i]);
+        row_zeroes_needed
+            = KERNEL_HALF - __builtin_popcount(board->row_zeros[i]);
+        for (j = 0; j < KERNEL_SIZE; j++) {
+            if ((board->row_ones[i] | board->row_zeros[i]) >> j & 1)
+                continue;
+            one_straws = row_ones_needed
+                         * (KERNEL_HALF - __builtin_popcount(board->col_ones[j]));
+            zero_straws
+                = row_zeroes_needed
+                  * (KERNEL_HALF - __builtin_popcount(board->col_zeros[j]));
+            one_probability = (1.0f * one_straws) / (one_straws + zero_straws);
+            dramaticity = one_probability < 0.5 ? 1 - one_probability
+                                                : one_probability;
+            if (!contender_found || dramaticity > most_dramaticity) {
+                contender_found = true;
+                most_dramatic_one_probability = one_probability;
+                most_dramaticity = dramaticity;
+                most_dramatic_i = i;
+                most_dramatic_j = j;
+            }
+        }
+    }
+    if (!contender_found)
+        return SOLVE_SUCCESS;
+
+    if (allowed_guesses == 0)
+        return SOLVE_OUT_OF_GUESSES;
+    if (allowed_guesses != UINT16_MAX)
+        allowed_guesses--;
+
+    value = binary_puzzle_rng_next(&context->rng_state)
+            < most_dramatic_one_probability;
+    saved = *board;
+    KERNEL_FN(set)(board, most_dramatic_i, most_dramatic_j, value);
+    TRACE_EVENT(context->trace, BINARY_PUZZLE_EVENT_GUESS, most_dramatic_i,
+                most_dramatic_j, value);
+    solve_status = KERNEL_FN(search)(board, allowed_guesses, context);
+    if (solve_status == SOLVE_REACHED_INVALID) {
+        *board = saved;
+        KERNEL_FN(set)(board, most_dramatic_i, most_dramatic_j, !value);
+        TRACE_EVENT(context->trace, BINARY_PUZZLE_EVENT_BACKTRACK,
+                    most_dramatic_i, most_dramatic_j, !value);
+        solve_status = KERNEL_FN(search)(board, allowed_guesses, context);
+    }
+    return solve_status;
+}
+
+static solve_status_t KERNEL_FN(solve)(bool *solution, const bool *initialized,
+                                       uint16_t allowed_guesses,
+                                       SearchContext *context) {
+    KERNEL_BOARD board;
+    solve_status_t solve_status;
+    uint8_t i, j;
+
+    memset(&board, 0, sizeof(KERNEL_BOARD));
+    for (i = 0; i < KERNEL_SIZE; i++) {
+        for (j = 0; j < KERNEL_SIZE; j++) {
+            if (initialized[i * KERNEL_SIZE + j]) {
+                KERNEL_FN(set)(&board, i, j, solution[i * KERNEL_SIZE + j]);
+            }
+        }
+    }
+
+    solve_status = KERNEL_FN(search)(&board, allowed_guesses, context);
+    if (solve_status == SOLVE_SUCCESS) {
+        for (i = 0; i < KERNEL_SIZE; i++) {
+            for (j = 0; j < KERNEL_SIZE; j++) {
+                solution[i * KERNEL_SIZE + j] = board.row_ones[i] >> j & 1;
+            }
+        }
+    }
+    return solve_status;
+}
+
+/**
+ * Return `true` iff cell (i, j), currently missing from `givens`, can only be
+ * `value`.
+ */
+static bool KERNEL_FN(can_mask)(const KERNEL_BOARD *givens, uint8_t i,
+                                uint8_t j, bool value,
+                                uint16_t allowed_guesses,
+                                SearchContext *context) {
+    KERNEL_BOARD board = *givens;
+    KERNEL_WORD row_zero, row_one, col_zero, col_one;
+    BinaryPuzzleTrace *trace = context->trace;
+    bool forced_zero, forced_one, can_mask;
+
+    /* the rules alone settle the cell */
+    if (KERNEL_FN(line_forced)(board.row_ones[i], board.row_zeros[i],
+                               &row_zero, &row_one)
+        && KERNEL_FN(line_forced)(board.col_ones[j], board.col_zeros[j],
+                                  &col_zero, &col_one)) {
+        forced_zero = (row_zero >> j & 1) || (col_zero >> i & 1);
+        forced_one = (row_one >> j & 1) || (col_one >> i & 1);
+        if (forced_zero != forced_one && forced_one == value) {
+            return true;
+        }
+    }
+
+    /* otherwise the other value has to lead to a contradiction */
+    KERNEL_FN(set)(&board, i, j, !value);
+    context->search_ct++;
+    /* only the outcome is traced, not the search behind it */
+    context->trace = NULL;
+    can_mask = KERNEL_FN(search)(&board, allowed_guesses, context)
+               == SOLVE_REACHED_INVALID;
+    context->trace = trace;
+    return can_mask;
+}
+
+static void KERNEL_FN(initialize_mask)(const bool *solution, bool *mask,
+                                       uint16_t allowed_guesses,
+                                       SearchContext *context) {
+    KERNEL_BOARD givens;
+    uint8_t contenders[KERNEL_SIZE * KERNEL_SIZE];
+    size_t contender_ct = KERNEL_SIZE * KERNEL_SIZE;
+    size_t contender_idx, cell;
+    uint8_t i, j;
+
+    memset(&givens, 0, sizeof(KERNEL_BOARD));
+    for (cell = 0; cell < KERNEL_SIZE * KERNEL_SIZE; cell++) {
+        contenders[cell] = cell;
+        if (mask[cell]) {
+            KERNEL_FN(set)(&givens, cell / KERNEL_SIZE, cell % KERNEL_SIZE,
+                           solution[cell]);
+        }
+    }
+
+    while (contender_ct > 0 && !binary_puzzle_search_cancelled(context)) {
+        contender_idx
+            = binary_puzzle_rng_next(&context->rng_state) * contender_ct;
+        cell = contenders[contender_idx];
+        contenders[contender_idx] = contenders[--contender_ct];
+        if (!mask[cell])
+            continue;
+
+        i = cell / KERNEL_SIZE;
+        j = cell % KERNEL_SIZE;
+        KERNEL_FN(unset)(&givens, i, j);
+        if (KERNEL_FN(can_mask)(&givens, i, j, solution[cell],
+                                allowed_guesses, context)) {
+            mask[cell] = false;
+            TRACE_EVENT(context->trace, BINARY_PUZZLE_EVENT_MASK_ACCEPT, i, j,
+                        false);
+        } else {
+            KERNEL_FN(set)(&givens, i, j, solution[cell]);
+            TRACE_EVENT(context->trace, BINARY_PUZZLE_EVENT_MASK_REJECT, i, j,
+                        false);
+        }
+    }
+}
+
+#undef KERNEL_FULL
+#undef KERNEL_HALF
+#undef KERNEL_BOARD
@@ -0,0 +1,104 @@
+#define _POSIX_C_SOURCE 200809L
+#include "latency_log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* bucket `k` holds times below 2^(k + 1) microseconds, the last one the rest */
+#define LATENCY_BUCKETS 30
+
+struct LatencyLog {
+    /* key read to frame written */
+    uint32_t key_to_frame[LATENCY_BUCKETS];
+    /* frame start to frame built */
+    uint32_t build[LATENCY_BUCKETS];
+    /* frame built to frame written */
+    uint32_t write[LATENCY_BUCKETS];
+
+    uint64_t frame_ct;
+    uint64_t key_ct;
+    uint64_t byte_ct;
+    size_t max_frame_bytes;
+    uint64_t syscall_ct;
+
+    /* earliest key not answered by a frame yet, 0 for none */
+    uint64_t key_us;
+    uint64_t frame_start_us;
+    uint64_t frame_built_us;
+};
+
+static uint64_t monotonic_us(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+static void histogram_add(uint32_t *histogram, uint64_t us) {
+    size_t k = 0;
+    while (k + 1 < LATENCY_BUCKETS && us >= (uint64_t)2 << k) {
+        k++;
+    }
+    histogram[k]++;
+}
+
+LatencyLog *latency_log_create(void) {
+    return calloc(1, sizeof(LatencyLog));
+}
+
+void latency_log_key(LatencyLog *self) {
+    self->key_ct++;
+    if (self->key_us == 0)
+        self->key_us = monotonic_us();
+}
+
+void latency_log_frame_start(LatencyLog *self) {
+    self->frame_start_us = monotonic_us();
+}
+
+void latency_log_frame_built(LatencyLog *self) {
+    self->frame_built_us = monotonic_us();
+    histogram_add(self->build, self->frame_built_us - self->frame_start_us);
+}
+
+void latency_log_frame_written(LatencyLog *self, size_t byte_ct,
+                               uint32_t syscall_ct) {
+    const uint64_t now = monotonic_us();
+
+    histogram_add(self->write, now - self->frame_built_us);
+    if (self->key_us != 0) {
+        histogram_add(self->key_to_frame, now - self->key_us);
+        self->key_us = 0;
+    }
+    self->frame_ct++;
+    self->byte_ct += byte_ct;
+    if (byte_ct > self->max_frame_bytes)
+        self->max_frame_bytes = byte_ct;
+    self->syscall_ct += syscall_ct;
+}
+
+bool latency_log_save(const LatencyLog *self, const char *path) {
+    FILE *out = fopen(path, "w");
+    size_t k;
+    bool success;
+
+    if (out == NULL)
+        return false;
+    fprintf(out, "frames %lu\nkeys %lu\n", (unsigned long)self->frame_ct,
+            (unsigned long)self->key_ct);
+    fprintf(out, "frame_bytes_total %lu\nframe_bytes_max %lu\n",
+            (unsigned long)self->byte_ct, (unsigned long)self->max_frame_bytes);
+    fprintf(out, "syscalls_total %lu\n", (unsigned long)self->syscall_ct);
+    fprintf(out, "# below_us key_to_frame build write\n");
+    for (k = 0; k < LATENCY_BUCKETS; k++) {
+        if (self->key_to_frame[k] == 0 && self->build[k] == 0
+            && self->write[k] == 0)
+            continue;
+        fprintf(out, "%lu %lu %lu %lu\n", (unsigned long)2 << k,
+                (unsigned long)self->key_to_frame[k],
+                (unsigned long)self->build[k], (unsigned long)self->write[k]);
+    }
+    success = !ferror(out);
+    return fclose(out) == 0 && success;
+}
+
+void latency_log_destroy(LatencyLog *self) { free(self); }
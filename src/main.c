@@ -1,21 +1,258 @@
+#define _POSIX_C_SOURCE 200809L
 #include "binary_puzzle.h"
+#include "reporter.h"
+#include "tui.h"
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
+#include <unistd.h>
 
 #define BOARD_SIZE 10
+/* events kept by `-t`, the latest ones winning */
+#define TRACE_CAPACITY (1 << 20)
 
-int main(void) {
+static void print_usage(const char *program) {
+    printf("usage: %s [-n size] [-d easy|medium|hard] [-s seed] [-b count]\n"
+           "          [-v] [-u] [-m moves] [-r none|luby|geometric] [-p count]\n"
+           "          [-j threads] [-l ms] [-t trace] [-k latency]\n"
+           "\n"
+           "  -n size   side length, an even number below 256 (default %d)\n"
+           "  -d level  difficulty (default medium)\n"
+           "  -s seed   random seed (default current time)\n"
+           "  -b count  print `count` puzzles instead of playing one, one\n"
+           "            `<puzzle> <solution>` line each, `.` marking hidden "
+           "cells\n",
+           program, BOARD_SIZE);
+    printf("  -v        fill the batch with rotations, reflections and "
+           "complements\n"
+           "            of fewer generated puzzles\n"
+           "  -u        with -b, replace puzzles that repeat an earlier one up "
+           "to\n"
+           "            symmetry\n"
+           "  -m moves  with -b, walk each solution from the one before by "
+           "`moves`\n"
+           "            random moves instead of searching for it\n");
+    printf("  -r kind   schedule for restarting long solution searches "
+           "(default\n"
+           "            luby)\n"
+           "  -p count  race `count` searches on their own threads, keeping "
+           "the\n"
+           "            first puzzle finished (default 1)\n");
+    printf("  -j count  share each propagation round of boards above 14 "
+           "between\n"
+           "            `count` threads (default 1)\n"
+           "  -l ms     without -b, give up if the puzzle takes over `ms` "
+           "milliseconds\n"
+           "            to generate\n"
+           "  -t trace  record how the puzzle was generated into the file "
+           "`trace`,\n"
+           "            for `trace_replay` (needs a build with `make "
+           "TRACE=1`)\n"
+           "  -k file   time every key and frame of the interactive solver, "
+           "writing\n"
+           "            the histograms into `file` on exit\n");
+}
+
+static bool parse_difficulty(const char *name,
+                             binary_puzzle_difficulty_t *difficulty) {
+    if (strcmp(name, "easy") == 0) {
+        *difficulty = BINARY_PUZZLE_EASY;
+    } else if (strcmp(name, "medium") == 0) {
+        *difficulty = BINARY_PUZZLE_MEDIUM;
+    } else if (strcmp(name, "hard") == 0) {
+        *difficulty = BINARY_PUZZLE_HARD;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+static bool parse_restart_schedule(const char *name,
+                                   binary_puzzle_restart_t *schedule) {
+    if (strcmp(name, "none") == 0) {
+        *schedule = BINARY_PUZZLE_RESTART_NONE;
+    } else if (strcmp(name, "luby") == 0) {
+        *schedule = BINARY_PUZZLE_RESTART_LUBY;
+    } else if (strcmp(name, "geometric") == 0) {
+        *schedule = BINARY_PUZZLE_RESTART_GEOMETRIC;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Print `count` puzzles to stdout.
+ *
+ * Return `true` iff successful.
+ */
+static bool print_batch(const binary_puzzle_options_t *options, size_t count) {
+    BinaryPuzzle **puzzles;
+    binary_puzzle_status_t status;
+    char *cells, *solution;
+    size_t k;
+
+    puzzles = malloc(count * sizeof(BinaryPuzzle *));
+    cells = malloc((size_t)options->size * options->size + 1);
+    solution = malloc((size_t)options->size * options->size + 1);
+    if (puzzles == NULL || cells == NULL || solution == NULL) {
+        report_system_error("memory allocation failure");
+        free(puzzles);
+        free(cells);
+        free(solution);
+        return false;
+    }
+
+    status = binary_puzzle_generate_batch(options, puzzles, count);
+    if (status != BINARY_PUZZLE_OK) {
+        report_system_error(binary_puzzle_status_string(status));
+    } else {
+        for (k = 0; k < count; k++) {
+            binary_puzzle_write_cells(puzzles[k], false, cells);
+            binary_puzzle_write_cells(puzzles[k], true, solution);
+            printf("%s %s\n", cells, solution);
+            binary_puzzle_destroy(puzzles[k]);
+        }
+    }
+
+    free(puzzles);
+    free(cells);
+    free(solution);
+    return status == BINARY_PUZZLE_OK;
+}
+
+int main(int argc, char **argv) {
     BinaryPuzzle *binary_puzzle;
-    srand(time(NULL));
-    binary_puzzle = binary_puzzle_create(BOARD_SIZE, BINARY_PUZZLE_MEDIUM);
-
-    if (binary_puzzle != NULL) {
-#ifdef DEBUG
-        binary_puzzle_print(binary_puzzle);
-#else
-        binary_puzzle_interactive(binary_puzzle);
-#endif
-        binary_puzzle_destroy(binary_puzzle);
-    }
-    return 0;
+    BinaryPuzzleTrace *trace = NULL;
+    const char *trace_path = NULL;
+    const char *latency_path = NULL;
+    binary_puzzle_options_t options, first_options;
+    binary_puzzle_status_t status;
+    long batch_ct = 0;
+    bool dedup = false;
+    int opt, size = BOARD_SIZE, portfolio_ct = 1, propagation_ct = 1;
+    int exit_code = 0;
+
+    binary_puzzle_options_init(&options, BOARD_SIZE, BINARY_PUZZLE_MEDIUM);
+    options.seed = time(NULL);
+    while ((opt = getopt(argc, argv, "n:d:s:b:vum:r:p:j:l:t:k:h")) != -1) {
+        switch (opt) {
+        case 'n':
+            size = atoi(optarg);
+            break;
+        case 'd':
+            if (!parse_difficulty(optarg, &options.difficulty)) {
+                report_error("difficulty must be easy, medium or hard");
+                return 1;
+            }
+            break;
+        case 's':
+            options.seed = strtoul(optarg, NULL, 10);
+            break;
+        case 'b':
+            batch_ct = atol(optarg);
+            break;
+        case 'v':
+            options.batch_variants = true;
+            break;
+        case 'u':
+            dedup = true;
+            break;
+        case 'm':
+            options.batch_mixing_moves = strtoul(optarg, NULL, 10);
+            break;
+        case 'r':
+            if (!parse_restart_schedule(optarg, &options.restart_schedule)) {
+                report_error("restart schedule must be none, luby or geometric");
+                return 1;
+            }
+            break;
+        case 'p':
+            portfolio_ct = atoi(optarg);
+            break;
+        case 'j':
+            propagation_ct = atoi(optarg);
+            break;
+        case 'l':
+            options.time_budget_ms = strtoul(optarg, NULL, 10);
+            break;
+        case 't':
+            trace_path = optarg;
+            break;
+        case 'k':
+            latency_path = optarg;
+            break;
+        case 'h':
+            print_usage(argv[0]);
+            return 0;
+        default:
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (size <= 0 || size > UINT8_MAX || size % 2 != 0) {
+        report_error("size must be an even number between 2 and 254");
+        return 1;
+    }
+    options.size = size;
+    if (portfolio_ct <= 0 || portfolio_ct > UINT8_MAX) {
+        report_error("threads must be between 1 and 255");
+        return 1;
+    }
+    options.portfolio_threads = portfolio_ct;
+    if (propagation_ct <= 0 || propagation_ct > UINT8_MAX) {
+        report_error("threads must be between 1 and 255");
+        return 1;
+    }
+    options.propagation_threads = propagation_ct;
+
+    if (batch_ct > 0) {
+        if (dedup
+            && (options.dedup = binary_puzzle_set_create(batch_ct)) == NULL) {
+            report_system_error("memory allocation failure");
+            return 1;
+        }
+        exit_code = print_batch(&options, batch_ct) ? 0 : 1;
+        binary_puzzle_set_destroy(options.dedup);
+        return exit_code;
+    }
+
+    if (trace_path != NULL) {
+        options.trace = trace = binary_puzzle_trace_create(TRACE_CAPACITY);
+        if (trace == NULL) {
+            report_system_error("memory allocation failure");
+            return 1;
+        }
+    }
+    /*
+     * open on a puzzle the rules alone solve, leaving the slow part of the
+     * masking to the interactive solver's background thread
+     */
+    first_options = options;
+    if (trace_path == NULL)
+        first_options.mask_strategy = BINARY_PUZZLE_MASK_RULES;
+    status = binary_puzzle_generate(&first_options, &binary_puzzle);
+    /* a truncated puzzle is still a valid one, just an easier one */
+    if (status == BINARY_PUZZLE_TRUNCATED)
+        status = BINARY_PUZZLE_OK;
+    if (status == BINARY_PUZZLE_OK && trace != NULL) {
+        status = binary_puzzle_trace_save(trace, trace_path);
+        if (status != BINARY_PUZZLE_OK) {
+            binary_puzzle_destroy(binary_puzzle);
+        }
+    }
+    binary_puzzle_trace_destroy(trace);
+    if (status != BINARY_PUZZLE_OK) {
+        report_system_error(binary_puzzle_status_string(status));
+        return 1;
+    }
+
+    if (!binary_puzzle_interactive(binary_puzzle,
+                                   trace_path == NULL ? &options : NULL,
+                                   latency_path)) {
+        exit_code = 1;
+    }
+    binary_puzzle_destroy(binary_puzzle);
+    return exit_code;
 }
@@ -0,0 +1,168 @@
+#include "binary_puzzle_internal.h"
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * A solution held both row-major and column-major, so rows and columns are
+ * each contiguous and every move and check reads lines the same way with the
+ * two layouts swapped.
+ */
+typedef struct {
+    size_t size;
+    bool *rows;
+    bool *cols;
+} MixGrid;
+
+static size_t mix_pick(size_t bound, uint32_t *rng_state) {
+    return (size_t)(binary_puzzle_rng_next(rng_state) * bound);
+}
+
+/**
+ * Return two distinct random indices below `size` in `a` and `b`.
+ */
+static void mix_pick_pair(size_t size, uint32_t *rng_state, size_t *a,
+                          size_t *b) {
+    *a = mix_pick(size, rng_state);
+    *b = mix_pick(size - 1, rng_state);
+    if (*b >= *a)
+        (*b)++;
+}
+
+/**
+ * Return `true` iff no three cells in a row of `line` around `k` match.
+ */
+static bool mix_runs_ok(const bool *line, size_t size, size_t k) {
+    size_t start = k < 2 ? 0 : k - 2;
+
+    for (; start <= k && start + 2 < size; start++) {
+        if (line[start] == line[start + 1] && line[start] == line[start + 2])
+            return false;
+    }
+    return true;
+}
+
+/**
+ * Return `true` iff line `k` of `lines` matches no other line.
+ */
+static bool mix_line_unique(const bool *lines, size_t size, size_t k) {
+    size_t l;
+
+    for (l = 0; l < size; l++) {
+        if (l != k && memcmp(lines + l * size, lines + k * size, size) == 0)
+            return false;
+    }
+    return true;
+}
+
+/**
+ * Flip the corners of the rectangle between lines `a` and `b` of `major` and
+ * lines `c` and `d` of `minor`, the same board in the other layout, if they
+ * alternate. Each line then keeps its count of ones.
+ *
+ * Return `true` iff they were flipped and every rule still holds.
+ */
+static bool mix_flip_rectangle(bool *major, bool *minor, size_t size, size_t a,
+                               size_t b, size_t c, size_t d) {
+    bool ok;
+
+    if (major[a * size + c] == major[a * size + d]
+        || major[a * size + c] == major[b * size + c]
+        || major[a * size + c] != major[b * size + d])
+        return false;
+
+    major[a * size + c] = minor[c * size + a] = !major[a * size + c];
+    major[a * size + d] = minor[d * size + a] = !major[a * size + d];
+    major[b * size + c] = minor[c * size + b] = !major[b * size + c];
+    major[b * size + d] = minor[d * size + b] = !major[b * size + d];
+
+    ok = mix_runs_ok(major + a * size, size, c)
+         && mix_runs_ok(major + a * size, size, d)
+         && mix_runs_ok(major + b * size, size, c)
+         && mix_runs_ok(major + b * size, size, d)
+         && mix_runs_ok(minor + c * size, size, a)
+         && mix_runs_ok(minor + c * size, size, b)
+         && mix_runs_ok(minor + d * size, size, a)
+         && mix_runs_ok(minor + d * size, size, b)
+         && mix_line_unique(major, size, a) && mix_line_unique(major, size, b)
+         && mix_line_unique(minor, size, c) && mix_line_unique(minor, size, d);
+    if (!ok) {
+        /* flipping again puts the rectangle back */
+        major[a * size + c] = minor[c * size + a] = !major[a * size + c];
+        major[a * size + d] = minor[d * size + a] = !major[a * size + d];
+        major[b * size + c] = minor[c * size + b] = !major[b * size + c];
+        major[b * size + d] = minor[d * size + b] = !major[b * size + d];
+    }
+    return ok;
+}
+
+/**
+ * Swap lines `a` and `b` of `major`, moving the same cells in `minor`. The
+ * lines of `minor` are permuted alike, so they stay distinct and balanced.
+ *
+ * Return `true` iff no line of `minor` ends up with three in a row.
+ */
+static bool mix_swap_lines(bool *major, bool *minor, size_t size, size_t a,
+                           size_t b) {
+    size_t k;
+    bool cell, ok = true;
+
+    for (k = 0; k < size; k++) {
+        cell = major[a * size + k];
+        major[a * size + k] = major[b * size + k];
+        major[b * size + k] = cell;
+        minor[k * size + a] = major[a * size + k];
+        minor[k * size + b] = major[b * size + k];
+    }
+    for (k = 0; k < size && ok; k++) {
+        ok = mix_runs_ok(minor + k * size, size, a)
+             && mix_runs_ok(minor + k * size, size, b);
+    }
+    if (!ok)
+        mix_swap_lines(major, minor, size, a, b);
+    return ok;
+}
+
+/**
+ * Propose one random move on `grid`, keeping it only if every rule still
+ * holds. Each move undoes itself and is proposed as often from either side,
+ * so a long enough walk reaches every reachable solution about equally.
+ */
+static void mix_step(MixGrid *grid, uint32_t *rng_state) {
+    const bool along_rows = binary_puzzle_rng_next(rng_state) < 0.5;
+    bool *major = along_rows ? grid->rows : grid->cols;
+    bool *minor = along_rows ? grid->cols : grid->rows;
+    size_t a, b, c, d;
+
+    mix_pick_pair(grid->size, rng_state, &a, &b);
+    if (binary_puzzle_rng_next(rng_state) < 0.5) {
+        mix_swap_lines(major, minor, grid->size, a, b);
+    } else {
+        mix_pick_pair(grid->size, rng_state, &c, &d);
+        mix_flip_rectangle(major, minor, grid->size, a, b, c, d);
+    }
+}
+
+binary_puzzle_status_t binary_puzzle_mix_solution(bool *solution, uint8_t size,
+                                                  uint32_t move_ct,
+                                                  uint32_t *rng_state) {
+    const size_t cell_ct = (size_t)size * size;
+    MixGrid grid;
+    size_t i, j;
+
+    grid.size = size;
+    grid.rows = solution;
+    grid.cols = malloc(cell_ct * sizeof(bool));
+    if (grid.cols == NULL)
+        return BINARY_PUZZLE_ERR_NO_MEMORY;
+    for (i = 0; i < size; i++) {
+        for (j = 0; j < size; j++) {
+            grid.cols[j * size + i] = solution[i * size + j];
+        }
+    }
+
+    for (; move_ct > 0; move_ct--) {
+        mix_step(&grid, rng_state);
+    }
+    free(grid.cols);
+    return BINARY_PUZZLE_OK;
+}
@@ -0,0 +1,131 @@
+#define _POSIX_C_SOURCE 200809L
+#include "binary_puzzle_internal.h"
+#include <pthread.h>
+#include <stdlib.h>
+
+typedef struct {
+    BinaryPuzzlePool *pool;
+    /* part of each job this thread runs */
+    size_t part;
+    pthread_t thread;
+} PoolWorker;
+
+/*
+ * Threads parked between jobs. Each job bumps `round` and wakes them all;
+ * the caller then waits for `pending` to reach 0.
+ */
+struct BinaryPuzzlePool {
+    pthread_mutex_t lock;
+    pthread_cond_t start;
+    pthread_cond_t finish;
+    PoolWorker *workers;
+    /* threads started, not counting the caller */
+    size_t worker_ct;
+    binary_puzzle_pool_job_fn job;
+    void *arg;
+    unsigned long round;
+    size_t pending;
+    bool stopping;
+};
+
+static void *pool_worker_run(void *arg) {
+    PoolWorker *worker = arg;
+    BinaryPuzzlePool *pool = worker->pool;
+    unsigned long seen_round = 0;
+    binary_puzzle_pool_job_fn job;
+    void *job_arg;
+
+    pthread_mutex_lock(&pool->lock);
+    for (;;) {
+        while (pool->round == seen_round && !pool->stopping) {
+            pthread_cond_wait(&pool->start, &pool->lock);
+        }
+        if (pool->stopping)
+            break;
+        seen_round = pool->round;
+        job = pool->job;
+        job_arg = pool->arg;
+        pthread_mutex_unlock(&pool->lock);
+
+        job(job_arg, worker->part, pool->worker_ct + 1);
+
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->pending == 0)
+            pthread_cond_signal(&pool->finish);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+BinaryPuzzlePool *binary_puzzle_pool_create(uint8_t thread_ct) {
+    BinaryPuzzlePool *new;
+    size_t k;
+
+    new = calloc(1, sizeof(BinaryPuzzlePool));
+    if (new == NULL)
+        return NULL;
+    new->workers
+        = malloc((thread_ct > 1 ? thread_ct - 1 : 1) * sizeof(PoolWorker));
+    if (new->workers == NULL) {
+        free(new);
+        return NULL;
+    }
+    pthread_mutex_init(&new->lock, NULL);
+    pthread_cond_init(&new->start, NULL);
+    pthread_cond_init(&new->finish, NULL);
+
+    for (k = 0; k + 1 < thread_ct; k++) {
+        new->workers[k].pool = new;
+        new->workers[k].part = k + 1;
+        if (pthread_create(&new->workers[k].thread, NULL, pool_worker_run,
+                           &new->workers[k])
+            != 0) {
+            binary_puzzle_pool_destroy(new);
+            return NULL;
+        }
+        new->worker_ct++;
+    }
+    return new;
+}
+
+size_t binary_puzzle_pool_get_threads(const BinaryPuzzlePool *self) {
+    return self->worker_ct + 1;
+}
+
+void binary_puzzle_pool_run(BinaryPuzzlePool *self,
+                            binary_puzzle_pool_job_fn job, void *arg) {
+    pthread_mutex_lock(&self->lock);
+    self->job = job;
+    self->arg = arg;
+    self->pending = self->worker_ct;
+    self->round++;
+    pthread_cond_broadcast(&self->start);
+    pthread_mutex_unlock(&self->lock);
+
+    job(arg, 0, self->worker_ct + 1);
+
+    pthread_mutex_lock(&self->lock);
+    while (self->pending > 0) {
+        pthread_cond_wait(&self->finish, &self->lock);
+    }
+    pthread_mutex_unlock(&self->lock);
+}
+
+void binary_puzzle_pool_destroy(BinaryPuzzlePool *self) {
+    size_t k;
+
+    if (self == NULL)
+        return;
+    pthread_mutex_lock(&self->lock);
+    self->stopping = true;
+    pthread_cond_broadcast(&self->start);
+    pthread_mutex_unlock(&self->lock);
+    for (k = 0; k < self->worker_ct; k++) {
+        pthread_join(self->workers[k].thread, NULL);
+    }
+    pthread_cond_destroy(&self->finish);
+    pthread_cond_destroy(&self->start);
+    pthread_mutex_destroy(&self->lock);
+    free(self->workers);
+    free(self);
+}
@@ -0,0 +1,124 @@
+#define _POSIX_C_SOURCE 200809L
+#include "binary_puzzle.h"
+#include "binary_puzzle_internal.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+/* more threads than this mostly add cancellation latency */
+#define PORTFOLIO_MAX_THREADS 16
+
+typedef struct {
+    pthread_mutex_t lock;
+    /* set once a worker finishes, telling the others to stop */
+    int cancelled;
+    BinaryPuzzle *winner;
+    /* `BINARY_PUZZLE_TRUNCATED` if the winner ran out of time masking */
+    binary_puzzle_status_t winner_status;
+    /* first failure other than cancellation, reported if nobody wins */
+    binary_puzzle_status_t status;
+} Portfolio;
+
+typedef struct {
+    Portfolio *portfolio;
+    binary_puzzle_options_t options;
+} PortfolioWorker;
+
+static void *portfolio_worker_run(void *arg) {
+    PortfolioWorker *worker = arg;
+    Portfolio *portfolio = worker->portfolio;
+    BinaryPuzzle *puzzle;
+    binary_puzzle_status_t status = binary_puzzle_generate_cancellable(
+        &worker->options, &portfolio->cancelled, &puzzle);
+
+    pthread_mutex_lock(&portfolio->lock);
+    if ((status == BINARY_PUZZLE_OK || status == BINARY_PUZZLE_TRUNCATED)
+        && portfolio->winner == NULL) {
+        portfolio->winner = puzzle;
+        portfolio->winner_status = status;
+        __atomic_store_n(&portfolio->cancelled, 1, __ATOMIC_RELAXED);
+        puzzle = NULL;
+    } else if (puzzle == NULL && status != BINARY_PUZZLE_ERR_CANCELLED
+               && portfolio->status == BINARY_PUZZLE_OK) {
+        portfolio->status = status;
+    }
+    pthread_mutex_unlock(&portfolio->lock);
+    /* finished too, but second */
+    binary_puzzle_destroy(puzzle);
+    return NULL;
+}
+
+uint8_t binary_puzzle_portfolio_default_threads(void) {
+    long cpu_ct = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpu_ct < 1)
+        return 1;
+    return cpu_ct < PORTFOLIO_MAX_THREADS ? cpu_ct : PORTFOLIO_MAX_THREADS;
+}
+
+binary_puzzle_status_t
+binary_puzzle_generate_portfolio(const binary_puzzle_options_t *options,
+                                 BinaryPuzzle **out) {
+    Portfolio portfolio;
+    PortfolioWorker *workers;
+    pthread_t *threads;
+    size_t k, started_ct = 0;
+    binary_puzzle_status_t status;
+
+    *out = NULL;
+    workers = malloc(options->portfolio_threads * sizeof(PortfolioWorker));
+    threads = malloc(options->portfolio_threads * sizeof(pthread_t));
+    if (workers == NULL || threads == NULL) {
+        free(workers);
+        free(threads);
+        return BINARY_PUZZLE_ERR_NO_MEMORY;
+    }
+    pthread_mutex_init(&portfolio.lock, NULL);
+    portfolio.cancelled = 0;
+    portfolio.winner = NULL;
+    portfolio.status = BINARY_PUZZLE_OK;
+
+    for (k = 0; k < options->portfolio_threads; k++) {
+        workers[k].portfolio = &portfolio;
+        workers[k].options = *options;
+        workers[k].options.trace = NULL;
+        workers[k].options.seed = options->seed + k;
+        /* vary the restart schedule too, so workers differ in more than luck */
+        if (k % 2 == 1
+            && options->restart_schedule == BINARY_PUZZLE_RESTART_LUBY) {
+            workers[k].options.restart_schedule = BINARY_PUZZLE_RESTART_GEOMETRIC;
+        } else if (k % 2 == 1
+                   && options->restart_schedule
+                          == BINARY_PUZZLE_RESTART_GEOMETRIC) {
+            workers[k].options.restart_schedule = BINARY_PUZZLE_RESTART_LUBY;
+        }
+        if (pthread_create(&threads[k], NULL, portfolio_worker_run,
+                           &workers[k])
+            != 0)
+            break;
+        started_ct++;
+    }
+    if (started_ct == 0) {
+        /* no threads to be had, so race nobody */
+        status = binary_puzzle_generate_cancellable(options, NULL, out);
+        goto binary_puzzle_generate_portfolio_done;
+    }
+
+    for (k = 0; k < started_ct; k++) {
+        pthread_join(threads[k], NULL);
+    }
+    if (portfolio.winner != NULL) {
+        *out = portfolio.winner;
+        status = portfolio.winner_status;
+    } else {
+        /* with no other failure, the caller's token stopped everyone */
+        status = portfolio.status != BINARY_PUZZLE_OK
+                     ? portfolio.status
+                     : BINARY_PUZZLE_ERR_CANCELLED;
+    }
+
+binary_puzzle_generate_portfolio_done:
+    pthread_mutex_destroy(&portfolio.lock);
+    free(workers);
+    free(threads);
+    return status;
+}
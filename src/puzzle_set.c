@@ -0,0 +1,90 @@
+#include "binary_puzzle.h"
+#include <stdlib.h>
+
+/* slots sharing a hash bucket, one cache line of hashes */
+#define SET_BUCKET_SLOTS 8
+
+/*
+ * Open hash set of canonical hashes. A hash only ever lives in its own
+ * bucket, filled in slot order, so concurrent inserts of the same hash race
+ * for the same empty slot and the loser sees the winner's hash there. A full
+ * bucket overwrites a slot picked by the new hash the same way, so a thread
+ * that loses that slot scans the bucket again rather than overwrite blindly.
+ */
+struct BinaryPuzzleSet {
+    /* 0 marks an empty slot */
+    uint64_t *slots;
+    size_t bucket_mask;
+    size_t count;
+};
+
+BinaryPuzzleSet *binary_puzzle_set_create(size_t capacity) {
+    BinaryPuzzleSet *new;
+    size_t bucket_ct = 1;
+
+    /* half full on average, so few buckets overflow before `capacity` */
+    while (bucket_ct * SET_BUCKET_SLOTS < 2 * capacity) {
+        bucket_ct *= 2;
+    }
+    new = malloc(sizeof(BinaryPuzzleSet));
+    if (new == NULL)
+        return NULL;
+    new->slots = calloc(bucket_ct * SET_BUCKET_SLOTS, sizeof(uint64_t));
+    if (new->slots == NULL) {
+        free(new);
+        return NULL;
+    }
+    new->bucket_mask = bucket_ct - 1;
+    new->count = 0;
+    return new;
+}
+
+bool binary_puzzle_set_insert(BinaryPuzzleSet *self,
+                              const BinaryPuzzle *puzzle) {
+    uint64_t hash = binary_puzzle_canonical_hash(puzzle);
+    uint64_t *bucket, *victim, seen;
+    size_t k;
+
+    if (hash == 0)
+        hash = 1;
+    bucket = self->slots + (hash & self->bucket_mask) * SET_BUCKET_SLOTS;
+    /* the bucket index used the low bits, so pick the slot with high ones */
+    victim = &bucket[(hash >> 32) % SET_BUCKET_SLOTS];
+    for (;;) {
+        for (k = 0; k < SET_BUCKET_SLOTS; k++) {
+            seen = __atomic_load_n(&bucket[k], __ATOMIC_RELAXED);
+            if (seen == 0) {
+                if (__atomic_compare_exchange_n(&bucket[k], &seen, hash, false,
+                                                __ATOMIC_RELAXED,
+                                                __ATOMIC_RELAXED)) {
+                    __atomic_add_fetch(&self->count, 1, __ATOMIC_RELAXED);
+                    return true;
+                }
+                /* `seen` now holds whatever another thread put there */
+            }
+            if (seen == hash)
+                return false;
+        }
+
+        seen = __atomic_load_n(victim, __ATOMIC_RELAXED);
+        if (seen != hash
+            && __atomic_compare_exchange_n(victim, &seen, hash, false,
+                                           __ATOMIC_RELAXED,
+                                           __ATOMIC_RELAXED)) {
+            __atomic_add_fetch(&self->count, 1, __ATOMIC_RELAXED);
+            return true;
+        }
+        /* another thread changed the slot, maybe to this very hash */
+    }
+}
+
+size_t binary_puzzle_set_get_count(const BinaryPuzzleSet *self) {
+    return __atomic_load_n(&self->count, __ATOMIC_RELAXED);
+}
+
+void binary_puzzle_set_destroy(BinaryPuzzleSet *self) {
+    if (self != NULL) {
+        free(self->slots);
+        free(self);
+    }
+}
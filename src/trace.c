@@ -0,0 +1,183 @@
+#define _POSIX_C_SOURCE 200809L
+#include "binary_puzzle.h"
+#include "binary_puzzle_internal.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/*
+ * Trace files are a header followed by the events, oldest first, all in host
+ * byte order:
+ *
+ * 4 bytes  "BPTR"
+ * 1 byte   format version, TRACE_VERSION
+ * 1 byte   board size
+ * 2 bytes  zero
+ * 4 bytes  event count
+ * 4 bytes  dropped event count
+ * 16 bytes per event, a `binary_puzzle_event_t` with its padding
+ */
+#define TRACE_MAGIC "BPTR"
+#define TRACE_VERSION 2
+
+struct BinaryPuzzleTrace {
+    uint8_t size;
+    binary_puzzle_event_t *events;
+    size_t capacity;
+    /* index the next event goes to */
+    size_t next_idx;
+    size_t event_ct;
+    size_t dropped_ct;
+    struct timespec start;
+};
+
+typedef struct {
+    char magic[4];
+    uint8_t version;
+    uint8_t size;
+    uint8_t reserved[2];
+    uint32_t event_ct;
+    uint32_t dropped_ct;
+} TraceHeader;
+
+BinaryPuzzleTrace *binary_puzzle_trace_create(size_t capacity) {
+    BinaryPuzzleTrace *new;
+    if (capacity == 0)
+        return NULL;
+
+    new = calloc(1, sizeof(BinaryPuzzleTrace));
+    if (new == NULL)
+        return NULL;
+    new->events = malloc(capacity * sizeof(binary_puzzle_event_t));
+    if (new->events == NULL) {
+        free(new);
+        return NULL;
+    }
+    new->capacity = capacity;
+    clock_gettime(CLOCK_MONOTONIC, &new->start);
+    return new;
+}
+
+void binary_puzzle_trace_begin(BinaryPuzzleTrace *self, uint8_t size) {
+    self->size = size;
+}
+
+void binary_puzzle_trace_record(BinaryPuzzleTrace *self,
+                                binary_puzzle_event_kind_t kind, size_t i,
+                                size_t j, bool value) {
+    binary_puzzle_event_t *event = &self->events[self->next_idx];
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    event->time_us = (uint64_t)(now.tv_sec - self->start.tv_sec) * 1000000
+                     + (now.tv_nsec - self->start.tv_nsec) / 1000;
+    event->kind = kind;
+    event->i = i;
+    event->j = j;
+    event->value = value;
+
+    self->next_idx = (self->next_idx + 1) % self->capacity;
+    if (self->event_ct < self->capacity) {
+        self->event_ct++;
+    } else {
+        self->dropped_ct++;
+    }
+}
+
+binary_puzzle_status_t binary_puzzle_trace_save(const BinaryPuzzleTrace *self,
+                                                const char *path) {
+    TraceHeader header;
+    size_t k;
+    binary_puzzle_event_t event;
+    bool ok;
+    FILE *file = fopen(path, "wb");
+    if (file == NULL)
+        return BINARY_PUZZLE_ERR_IO;
+
+    memset(&header, 0, sizeof(TraceHeader));
+    memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+    header.version = TRACE_VERSION;
+    header.size = self->size;
+    header.event_ct = self->event_ct;
+    header.dropped_ct = self->dropped_ct;
+    ok = fwrite(&header, sizeof(TraceHeader), 1, file) == 1;
+    for (k = 0; ok && k < self->event_ct; k++) {
+        event = binary_puzzle_trace_get_event(self, k);
+        ok = fwrite(&event, sizeof(binary_puzzle_event_t), 1, file) == 1;
+    }
+
+    if (fclose(file) != 0)
+        ok = false;
+    return ok ? BINARY_PUZZLE_OK : BINARY_PUZZLE_ERR_IO;
+}
+
+binary_puzzle_status_t binary_puzzle_trace_load(const char *path,
+                                                BinaryPuzzleTrace **out) {
+    TraceHeader header;
+    BinaryPuzzleTrace *new = NULL;
+    binary_puzzle_status_t status = BINARY_PUZZLE_ERR_IO;
+    FILE *file = fopen(path, "rb");
+
+    *out = NULL;
+    if (file == NULL)
+        return BINARY_PUZZLE_ERR_IO;
+    if (fread(&header, sizeof(TraceHeader), 1, file) != 1)
+        goto binary_puzzle_trace_load_done;
+    if (memcmp(header.magic, TRACE_MAGIC, sizeof(header.magic)) != 0
+        || header.version != TRACE_VERSION) {
+        status = BINARY_PUZZLE_ERR_INVALID_ARGUMENT;
+        goto binary_puzzle_trace_load_done;
+    }
+
+    new = binary_puzzle_trace_create(header.event_ct == 0 ? 1
+                                                          : header.event_ct);
+    if (new == NULL) {
+        status = BINARY_PUZZLE_ERR_NO_MEMORY;
+        goto binary_puzzle_trace_load_done;
+    }
+    if (fread(new->events, sizeof(binary_puzzle_event_t), header.event_ct,
+              file)
+        != header.event_ct)
+        goto binary_puzzle_trace_load_done;
+    new->size = header.size;
+    new->event_ct = header.event_ct;
+    new->next_idx = header.event_ct % new->capacity;
+    new->dropped_ct = header.dropped_ct;
+    status = BINARY_PUZZLE_OK;
+
+binary_puzzle_trace_load_done:
+    fclose(file);
+    if (status == BINARY_PUZZLE_OK) {
+        *out = new;
+    } else {
+        binary_puzzle_trace_destroy(new);
+    }
+    return status;
+}
+
+uint8_t binary_puzzle_trace_get_size(const BinaryPuzzleTrace *self) {
+    return self->size;
+}
+
+size_t binary_puzzle_trace_get_event_count(const BinaryPuzzleTrace *self) {
+    return self->event_ct;
+}
+
+size_t binary_puzzle_trace_get_dropped_count(const BinaryPuzzleTrace *self) {
+    return self->dropped_ct;
+}
+
+binary_puzzle_event_t
+binary_puzzle_trace_get_event(const BinaryPuzzleTrace *self, size_t k) {
+    /* the oldest event sits where the next one will go once the ring is full */
+    size_t oldest_idx = self->event_ct < self->capacity ? 0 : self->next_idx;
+    return self->events[(oldest_idx + k) % self->capacity];
+}
+
+void binary_puzzle_trace_destroy(BinaryPuzzleTrace *self) {
+    if (self != NULL) {
+        free(self->events);
+        free(self);
+    }
+}
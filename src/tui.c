@@ -0,0 +1,547 @@
+#include "tui.h"
+#include "colors.h"
+#include "latency_log.h"
+#include "reporter.h"
+#include "string_builder.h"
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <termios.h>
+#include <unistd.h>
+
+#define FILENAME "tui.c"
+
+#define HARDER_PROMPT "H: harder puzzle"
+
+typedef enum { CELL_ZERO, CELL_ONE, CELL_INVALID, CELL_UNKNOWN } cell_state_t;
+
+typedef struct {
+    const BinaryPuzzle *puzzle;
+    uint8_t size;
+
+    /* row-major, `size * size` entries */
+    cell_state_t *user_guesses;
+
+    uint8_t i_selected;
+    uint8_t j_selected;
+
+    /* top left cell on screen */
+    uint8_t i_top;
+    uint8_t j_left;
+    /* draw every cell as a single character instead of a box */
+    bool compact;
+
+    /* options for hiding more cells of `puzzle` */
+    binary_puzzle_options_t harder_options;
+    pthread_t masker;
+    bool masking;
+    /* stops `masker` */
+    BinaryPuzzleCancel *cancel;
+    pthread_mutex_t lock;
+    /* finished by `masker` but not shown yet, guarded by `lock` */
+    BinaryPuzzle *harder;
+    /* `harder` once it is shown */
+    BinaryPuzzle *shown_harder;
+    /* whether any cell was set, after which `harder` is only offered */
+    bool edited;
+    bool harder_offered;
+
+    uint16_t row_ct;
+    uint16_t col_ct;
+    struct termios orig_termios;
+
+    /* where frames and keys are timed, `NULL` if they are not */
+    LatencyLog *latency;
+} Session;
+
+static bool disable_raw_mode(Session *session) {
+    if (tcsetattr(STDIN_FILENO, TCSAFLUSH, &session->orig_termios) == -1) {
+        printf(CLEAR_SCREEN RESET_CURSOR SHOW_CURSOR);
+        report_system_error(FILENAME ": failed to disable raw mode");
+        return false;
+    }
+    return true;
+}
+
+static bool update_window_size(Session *session) {
+    struct winsize ws;
+
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == -1 || ws.ws_col == 0) {
+        report_system_error(FILENAME ": failed to get window size");
+        return false;
+    }
+
+    session->col_ct = ws.ws_col;
+    session->row_ct = ws.ws_row;
+    return true;
+}
+
+/**
+ * Return `true` iff the window no longer has the size drawn last.
+ */
+static bool window_resized(const Session *session) {
+    struct winsize ws;
+
+    return ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0
+           && (ws.ws_col != session->col_ct || ws.ws_row != session->row_ct);
+}
+
+static bool enable_raw_mode(Session *session) {
+    struct termios raw;
+
+    if (tcgetattr(STDIN_FILENO, &session->orig_termios) == -1) {
+        report_system_error(FILENAME ": failed to get terminal attributes");
+        return false;
+    }
+
+    raw = session->orig_termios;
+
+    /* disable ctrl+s and ctrl+q */
+    raw.c_iflag &= ~IXON;
+
+    /* ensure 8th bit preserved */
+    raw.c_iflag &= ~ISTRIP;
+
+    /* disable ctrl+v */
+    raw.c_lflag &= ~IEXTEN;
+
+    /* disable showing charcters as they're typed */
+    raw.c_lflag &= ~ECHO;
+
+    /* disable canonical mode (read byte-by-byte) */
+    raw.c_lflag &= ~ICANON;
+
+    /* disable output processing */
+    raw.c_oflag &= ~OPOST;
+
+    /* ensure 8 bits per character */
+    raw.c_cflag |= CS8;
+
+    /* set minimum bytes to read for read() to return */
+    raw.c_cc[VMIN] = 0;
+
+    /* time in deciseconds before read() should return */
+    raw.c_cc[VTIME] = 1;
+
+    if (tcsetattr(STDIN_FILENO, TCSAFLUSH, &raw) == -1) {
+        report_system_error(FILENAME ": failed to enter raw mode");
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Append `count` copies of `text` to `contents`.
+ */
+static void append_repeated(StringBuilder *contents, const char *text,
+                            uint16_t count) {
+    uint16_t k;
+    for (k = 0; k < count; k++) {
+        string_builder_append(contents, text);
+    }
+}
+
+/**
+ * Return the first of `visible` lines to show out of `size` so that line
+ * `selected` stays on screen, moving as little as possible from `first`.
+ */
+static uint8_t scroll_to(uint8_t first, uint8_t selected, uint16_t visible,
+                         uint8_t size) {
+    if (selected < first) {
+        first = selected;
+    } else if (selected >= first + visible) {
+        first = selected - visible + 1;
+    }
+    /* the terminal may have grown since `first` was picked */
+    if (first + visible > size) {
+        first = size - visible;
+    }
+    return first;
+}
+
+/**
+ * Append the colored digit of cell (`i`, `j`) to `contents`.
+ */
+static void append_cell(StringBuilder *contents, const Session *session,
+                        uint8_t i, uint8_t j) {
+    if (binary_puzzle_is_given(session->puzzle, i, j)) {
+        string_builder_append(contents,
+                              binary_puzzle_get_solution(session->puzzle, i, j)
+                                  ? GREEN "1" RESET
+                                  : GREEN "0" RESET);
+        return;
+    }
+    switch (session->user_guesses[i * session->size + j]) {
+    case CELL_ZERO:
+        string_builder_append(contents, CYAN "0" RESET);
+        break;
+    case CELL_ONE:
+        string_builder_append(contents, CYAN "1" RESET);
+        break;
+    case CELL_UNKNOWN:
+        string_builder_append(contents, BLUE "_" RESET);
+        break;
+    default:
+        string_builder_append(contents, RED "?" RESET);
+        break;
+    }
+}
+
+/**
+ * Draw the part of the board that fits on screen, scrolled to keep the
+ * selected cell in view. Only visible cells are visited, so a frame costs
+ * the same on any board size.
+ */
+static bool session_update_screen(Session *session) {
+    const uint16_t cell_width = session->compact ? 1 : 5;
+    const uint16_t cell_height = session->compact ? 1 : 3;
+    uint16_t board_row_ct, visible_rows, visible_cols, left_pad, line_ct = 0;
+    bool prompt;
+    uint8_t i, j, i_end, j_end;
+    bool selected;
+    StringBuilder *contents;
+    const char *frame;
+    size_t frame_len, written_len = 0;
+    ssize_t write_status;
+    /* the window size query, then every write */
+    uint32_t syscall_ct = 1;
+    const char *pls_expand_screen = "Screen size too small";
+    if (session->latency != NULL)
+        latency_log_frame_start(session->latency);
+    if (!update_window_size(session)) {
+        return false;
+    }
+    contents = string_builder_create();
+    if (contents == NULL) {
+        return false;
+    }
+    string_builder_set(contents, CLEAR_SCREEN RESET_CURSOR HIDE_CURSOR);
+    /* the prompt takes the bottom row when there is one to spare */
+    prompt = session->harder_offered && session->row_ct > cell_height
+             && session->col_ct >= strlen(HARDER_PROMPT);
+    board_row_ct = prompt ? session->row_ct - 1 : session->row_ct;
+    if (board_row_ct >= cell_height && session->col_ct >= cell_width) {
+        visible_rows = board_row_ct / cell_height;
+        visible_cols = session->col_ct / cell_width;
+        if (visible_rows > session->size)
+            visible_rows = session->size;
+        if (visible_cols > session->size)
+            visible_cols = session->size;
+        session->i_top = scroll_to(session->i_top, session->i_selected,
+                                   visible_rows, session->size);
+        session->j_left = scroll_to(session->j_left, session->j_selected,
+                                    visible_cols, session->size);
+        i_end = session->i_top + visible_rows;
+        j_end = session->j_left + visible_cols;
+        left_pad = (session->col_ct - visible_cols * cell_width + 1) / 2;
+
+        append_repeated(contents, "\r\n",
+                        (board_row_ct - visible_rows * cell_height + 1) / 2);
+        for (i = session->i_top; i < i_end; i++) {
+            if (session->compact) {
+                if (line_ct++ > 0)
+                    string_builder_append(contents, "\r\n");
+                append_repeated(contents, " ", left_pad);
+                for (j = session->j_left; j < j_end; j++) {
+                    if (i == session->i_selected && j == session->j_selected)
+                        string_builder_append(contents, REVERSE);
+                    append_cell(contents, session, i, j);
+                }
+                continue;
+            }
+
+            /* top */
+            if (line_ct++ > 0)
+                string_builder_append(contents, "\r\n");
+            append_repeated(contents, " ", left_pad);
+            for (j = session->j_left; j < j_end; j++) {
+                if (i == session->i_selected && j == session->j_selected) {
+                    string_builder_append(contents, "╔═══╗");
+                } else {
+                    string_builder_append(contents, "┌───┐");
+                }
+            }
+
+            /* middle */
+            string_builder_append(contents, "\r\n");
+            append_repeated(contents, " ", left_pad);
+            for (j = session->j_left; j < j_end; j++) {
+                selected = i == session->i_selected && j == session->j_selected;
+                string_builder_append(contents, selected ? "║ " : "│ ");
+                append_cell(contents, session, i, j);
+                string_builder_append(contents, selected ? " ║" : " │");
+            }
+
+            /* bottom */
+            string_builder_append(contents, "\r\n");
+            append_repeated(contents, " ", left_pad);
+            for (j = session->j_left; j < j_end; j++) {
+                if (i == session->i_selected && j == session->j_selected) {
+                    string_builder_append(contents, "╚═══╝");
+                } else {
+                    string_builder_append(contents, "└───┘");
+                }
+            }
+        }
+        if (prompt) {
+            string_builder_append(contents, "\r\n");
+            append_repeated(contents, " ",
+                            (session->col_ct - strlen(HARDER_PROMPT) + 1) / 2);
+            string_builder_append(contents, YELLOW HARDER_PROMPT RESET);
+        }
+    } else {
+        append_repeated(contents, "\r\n", (session->row_ct + 1) / 2);
+        if (session->col_ct >= strlen(pls_expand_screen)) {
+            append_repeated(
+                contents, " ",
+                (session->col_ct - strlen(pls_expand_screen) + 1) / 2);
+            string_builder_append(contents, pls_expand_screen);
+        }
+    }
+    frame = string_builder_to_string(contents);
+    frame_len = string_builder_len(contents);
+    if (session->latency != NULL)
+        latency_log_frame_built(session->latency);
+    /* a large frame can fill the terminal's buffer, cutting writes short */
+    while (written_len < frame_len) {
+        write_status = write(STDOUT_FILENO, frame + written_len,
+                             frame_len - written_len);
+        if (write_status < 0 && errno != EINTR && errno != EAGAIN)
+            break;
+        if (write_status > 0)
+            written_len += write_status;
+        syscall_ct++;
+    }
+    if (session->latency != NULL)
+        latency_log_frame_written(session->latency, written_len, syscall_ct);
+    string_builder_destroy(contents);
+    return true;
+}
+
+/**
+ * Hide more cells of the starting puzzle, then hand the result to the
+ * session. Runs on its own thread; `puzzle` is only replaced after it is done
+ * reading it.
+ */
+static void *session_mask(void *arg) {
+    Session *session = arg;
+    BinaryPuzzle *harder;
+
+    if (binary_puzzle_harden(session->puzzle, &session->harder_options,
+                             &harder)
+        == BINARY_PUZZLE_OK) {
+        pthread_mutex_lock(&session->lock);
+        session->harder = harder;
+        pthread_mutex_unlock(&session->lock);
+    }
+    return NULL;
+}
+
+/**
+ * Show the harder puzzle if it is ready and either `take` is set or no cell
+ * has been set yet, so a board in progress never changes unasked.
+ *
+ * Return `true` iff the screen needs redrawing: the puzzle was replaced, or
+ * the harder one was just offered.
+ */
+static bool session_poll_harder(Session *session, bool take) {
+    const bool was_offered = session->harder_offered;
+    BinaryPuzzle *harder;
+    uint8_t i, j;
+
+    if (!session->masking)
+        return false;
+    pthread_mutex_lock(&session->lock);
+    harder = session->harder;
+    if (take || !session->edited) {
+        session->harder = NULL;
+    } else {
+        harder = NULL;
+    }
+    session->harder_offered = session->harder != NULL;
+    pthread_mutex_unlock(&session->lock);
+    if (harder == NULL)
+        return session->harder_offered != was_offered;
+
+    /* the cells hidden before are still hidden, keeping their guesses */
+    for (i = 0; i < session->size; i++) {
+        for (j = 0; j < session->size; j++) {
+            if (binary_puzzle_is_given(session->puzzle, i, j))
+                session->user_guesses[i * session->size + j] = CELL_UNKNOWN;
+        }
+    }
+    session->puzzle = session->shown_harder = harder;
+    return true;
+}
+
+bool binary_puzzle_interactive(const BinaryPuzzle *self,
+                               const binary_puzzle_options_t *harder,
+                               const char *latency_path) {
+    char key;
+    int read_status;
+    bool keep_playing = true;
+    bool success = true;
+    /* reads time out every tenth of a second, only drawing what changed */
+    bool redraw = true;
+    size_t i;
+    cell_state_t *selected;
+    Session session;
+
+    memset(&session, 0, sizeof(Session));
+    session.puzzle = self;
+    session.size = binary_puzzle_get_size(self);
+    session.user_guesses
+        = malloc((size_t)session.size * session.size * sizeof(cell_state_t));
+    if (session.user_guesses == NULL) {
+        report_system_error(FILENAME ": memory allocation failure");
+        return false;
+    }
+    for (i = 0; i < (size_t)session.size * session.size; i++) {
+        session.user_guesses[i] = CELL_UNKNOWN;
+    }
+    if (latency_path != NULL
+        && (session.latency = latency_log_create()) == NULL) {
+        report_system_error(FILENAME ": memory allocation failure");
+        free(session.user_guesses);
+        return false;
+    }
+
+    if (!enable_raw_mode(&session)) {
+        latency_log_destroy(session.latency);
+        free(session.user_guesses);
+        return false;
+    }
+
+    if (harder != NULL
+        && (session.cancel = binary_puzzle_cancel_create()) != NULL
+        && pthread_mutex_init(&session.lock, NULL) == 0) {
+        session.harder_options = *harder;
+        session.harder_options.cancel = session.cancel;
+        /* the board is already playable, so there is no hurry */
+        session.harder_options.time_budget_ms = 0;
+        session.masking = pthread_create(&session.masker, NULL, session_mask,
+                                         &session)
+                          == 0;
+        if (!session.masking)
+            pthread_mutex_destroy(&session.lock);
+    }
+
+    while (keep_playing) {
+        if (session_poll_harder(&session, false))
+            redraw = true;
+        if (redraw && !session_update_screen(&session)) {
+            success = false;
+            break;
+        }
+        redraw = false;
+        read_status = read(STDIN_FILENO, &key, 1);
+        selected = &session.user_guesses[session.i_selected * session.size
+                                         + session.j_selected];
+        if (read_status == 1) {
+            redraw = true;
+            if (session.latency != NULL)
+                latency_log_key(session.latency);
+            switch (key) {
+            case 'q':
+                printf(CLEAR_SCREEN RESET_CURSOR SHOW_CURSOR);
+                keep_playing = false;
+                break;
+            case 'h':
+                session.j_selected += session.size - 1;
+                session.j_selected %= session.size;
+                break;
+            case 'j':
+                session.i_selected++;
+                session.i_selected %= session.size;
+                break;
+            case 'k':
+                session.i_selected += session.size - 1;
+                session.i_selected %= session.size;
+                break;
+            case 'l':
+                session.j_selected++;
+                session.j_selected %= session.size;
+                break;
+            case '\n':
+            case ' ':
+                switch (*selected) {
+                case CELL_UNKNOWN:
+                    *selected = CELL_ZERO;
+                    break;
+                case CELL_ZERO:
+                    *selected = CELL_ONE;
+                    break;
+                case CELL_ONE:
+                    *selected = CELL_UNKNOWN;
+                    break;
+                default:
+                    break;
+                }
+                session.edited = true;
+                break;
+            case 'c':
+                session.compact = !session.compact;
+                break;
+            case 'H':
+                session_poll_harder(&session, true);
+                break;
+            case '0':
+                *selected = CELL_ZERO;
+                session.edited = true;
+                break;
+            case '1':
+                *selected = CELL_ONE;
+                session.edited = true;
+                break;
+            default:
+                break;
+            }
+        } else if (read_status == -1 && errno != EAGAIN) {
+            report_system_error(FILENAME ": failed to get user input");
+            success = false;
+            keep_playing = false;
+        } else {
+            redraw = window_resized(&session);
+        }
+    }
+
+    if (session.masking) {
+        binary_puzzle_cancel_request(session.cancel);
+        pthread_join(session.masker, NULL);
+        pthread_mutex_destroy(&session.lock);
+        binary_puzzle_destroy(session.harder);
+        binary_puzzle_destroy(session.shown_harder);
+    }
+    binary_puzzle_cancel_destroy(session.cancel);
+    if (!disable_raw_mode(&session)) {
+        success = false;
+    }
+    if (session.latency != NULL) {
+        if (!latency_log_save(session.latency, latency_path)) {
+            report_system_error(FILENAME ": failed to write latency log");
+            success = false;
+        }
+        latency_log_destroy(session.latency);
+    }
+    free(session.user_guesses);
+    return success;
+}
+
+void binary_puzzle_print(const BinaryPuzzle *self) {
+    const uint8_t size = binary_puzzle_get_size(self);
+    uint8_t i, j;
+    for (i = 0; i < size; i++) {
+        for (j = 0; j < size; j++) {
+            if (!binary_puzzle_is_given(self, i, j)) {
+                printf(BLUE "? " RESET);
+            } else {
+                printf(GREEN "%s " RESET,
+                       binary_puzzle_get_solution(self, i, j) ? "1" : "0");
+            }
+        }
+        printf("\n");
+    }
+}
@@ -0,0 +1,33 @@
+#ifndef CHECK_H
+#define CHECK_H
+#include <stdio.h>
+
+/*
+ * Checks shared by the test programs. A failed check is reported and
+ * counted, and the program carries on, so one run shows every failure.
+ */
+
+static int check_failure_ct = 0;
+
+#define CHECK(condition)                                                       \
+    do {                                                                       \
+        if (!(condition)) {                                                    \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__,  \
+                    #condition);                                               \
+            check_failure_ct++;                                                \
+        }                                                                      \
+    } while (0)
+
+/**
+ * Return the exit code of a test program, printing its result.
+ */
+static int check_done(const char *name) {
+    if (check_failure_ct > 0) {
+        fprintf(stderr, "%s: %d checks failed\n", name, check_failure_ct);
+        return 1;
+    }
+    printf("%s: ok\n", name);
+    return 0;
+}
+
+#endif
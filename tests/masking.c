@@ -0,0 +1,63 @@
+#include "binary_puzzle.h"
+#include "check.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* above the sizes with a kernel, where bulk masking applies */
+#define SIZE 24
+#define CELL_CT (SIZE * SIZE)
+#define SEED_CT 3
+
+/**
+ * Generate the `SIZE` puzzle of `seed` with `strategy` into `cells`, null
+ * terminated, adding its masking solves to `*solve_ct`.
+ *
+ * Return the status of the generation.
+ */
+static binary_puzzle_status_t generate(uint32_t seed,
+                                       binary_puzzle_mask_t strategy,
+                                       unsigned long *solve_ct, char *cells) {
+    binary_puzzle_options_t options;
+    binary_puzzle_stats_t stats;
+    BinaryPuzzle *puzzle = NULL;
+    binary_puzzle_status_t status;
+
+    binary_puzzle_options_init(&options, SIZE, BINARY_PUZZLE_MEDIUM);
+    options.seed = seed;
+    options.mask_strategy = strategy;
+    status = binary_puzzle_generate(&options, &puzzle);
+    if (status == BINARY_PUZZLE_OK) {
+        binary_puzzle_get_stats(puzzle, &stats);
+        *solve_ct += stats.mask_solves;
+        binary_puzzle_write_cells(puzzle, false, cells);
+    }
+    binary_puzzle_destroy(puzzle);
+    return status;
+}
+
+int main(void) {
+    char cells[CELL_CT + 1];
+    unsigned long single_ct = 0, bulk_ct = 0;
+    BinaryPuzzle *puzzle;
+    uint32_t seed;
+    bool unique;
+
+    for (seed = 1; seed <= SEED_CT; seed++) {
+        CHECK(generate(seed, BINARY_PUZZLE_MASK_SINGLE, &single_ct, cells)
+              == BINARY_PUZZLE_OK);
+
+        /* bulk puzzles still have exactly one solution */
+        CHECK(generate(seed, BINARY_PUZZLE_MASK_BULK, &bulk_ct, cells)
+              == BINARY_PUZZLE_OK);
+        puzzle = NULL;
+        CHECK(binary_puzzle_parse(SIZE, cells, &puzzle) == BINARY_PUZZLE_OK);
+        CHECK(binary_puzzle_solve(puzzle, UINT16_MAX) == BINARY_PUZZLE_OK);
+        CHECK(binary_puzzle_check_unique(puzzle, &unique) == BINARY_PUZZLE_OK
+              && unique);
+        binary_puzzle_destroy(puzzle);
+    }
+
+    /* batches settle many cells per solve while most can be hidden */
+    CHECK(bulk_ct < single_ct);
+    return check_done("masking");
+}
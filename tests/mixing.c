@@ -0,0 +1,125 @@
+#include "binary_puzzle_internal.h"
+#include "check.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define SIZE 12
+#define CELL_CT (SIZE * SIZE)
+#define MOVE_CT 2000
+#define BATCH_CT 8
+
+/**
+ * Return `true` iff line `k` of `cells`, a row or with `across` a column,
+ * has no three in a row and as many ones as zeros.
+ */
+static bool line_ok(const bool *cells, size_t k, bool across) {
+    size_t l, one_ct = 0;
+    bool cell, prev = false, prev2 = false;
+
+    for (l = 0; l < SIZE; l++) {
+        cell = across ? cells[l * SIZE + k] : cells[k * SIZE + l];
+        if (l >= 2 && cell == prev && cell == prev2)
+            return false;
+        one_ct += cell;
+        prev2 = prev;
+        prev = cell;
+    }
+    return one_ct == SIZE / 2;
+}
+
+/**
+ * Return `true` iff lines `a` and `b` of `cells` match.
+ */
+static bool lines_equal(const bool *cells, size_t a, size_t b, bool across) {
+    size_t l;
+
+    for (l = 0; l < SIZE; l++) {
+        if (across ? cells[l * SIZE + a] != cells[l * SIZE + b]
+                   : cells[a * SIZE + l] != cells[b * SIZE + l])
+            return false;
+    }
+    return true;
+}
+
+/**
+ * Return `true` iff `cells` keeps every rule of a solved board.
+ */
+static bool solution_ok(const bool *cells) {
+    size_t k, l;
+    int across;
+
+    for (across = 0; across < 2; across++) {
+        for (k = 0; k < SIZE; k++) {
+            if (!line_ok(cells, k, across))
+                return false;
+            for (l = k + 1; l < SIZE; l++) {
+                if (lines_equal(cells, k, l, across))
+                    return false;
+            }
+        }
+    }
+    return true;
+}
+
+int main(void) {
+    binary_puzzle_options_t options;
+    BinaryPuzzle *puzzle, *batch[BATCH_CT];
+    bool start[CELL_CT], mixed[CELL_CT], again[CELL_CT];
+    char cells[CELL_CT + 1], solution[CELL_CT + 1];
+    uint32_t rng_state;
+    size_t k;
+    bool unique;
+
+    binary_puzzle_options_init(&options, SIZE, BINARY_PUZZLE_MEDIUM);
+    options.seed = 5;
+    if (binary_puzzle_generate(&options, &puzzle) != BINARY_PUZZLE_OK) {
+        fprintf(stderr, "mixing: failed to generate a puzzle\n");
+        return 1;
+    }
+    binary_puzzle_write_cells(puzzle, true, solution);
+    binary_puzzle_destroy(puzzle);
+    for (k = 0; k < CELL_CT; k++) {
+        start[k] = solution[k] == '1';
+    }
+    CHECK(solution_ok(start));
+
+    /* no moves leave the solution alone */
+    memcpy(mixed, start, sizeof(mixed));
+    rng_state = binary_puzzle_rng_seed(1);
+    CHECK(binary_puzzle_mix_solution(mixed, SIZE, 0, &rng_state)
+          == BINARY_PUZZLE_OK);
+    CHECK(memcmp(mixed, start, sizeof(mixed)) == 0);
+
+    /* a walk keeps every rule, moves somewhere and is repeatable */
+    rng_state = binary_puzzle_rng_seed(1);
+    CHECK(binary_puzzle_mix_solution(mixed, SIZE, MOVE_CT, &rng_state)
+          == BINARY_PUZZLE_OK);
+    CHECK(solution_ok(mixed));
+    CHECK(memcmp(mixed, start, sizeof(mixed)) != 0);
+    memcpy(again, start, sizeof(again));
+    rng_state = binary_puzzle_rng_seed(1);
+    CHECK(binary_puzzle_mix_solution(again, SIZE, MOVE_CT, &rng_state)
+          == BINARY_PUZZLE_OK);
+    CHECK(memcmp(mixed, again, sizeof(mixed)) == 0);
+
+    /* every puzzle of a mixed batch has its solution as the only one */
+    options.batch_mixing_moves = 50;
+    CHECK(binary_puzzle_generate_batch(&options, batch, BATCH_CT)
+          == BINARY_PUZZLE_OK);
+    for (k = 0; k < BATCH_CT && batch[0] != NULL; k++) {
+        binary_puzzle_write_cells(batch[k], false, cells);
+        binary_puzzle_write_cells(batch[k], true, solution);
+        binary_puzzle_destroy(batch[k]);
+        if (binary_puzzle_parse(SIZE, cells, &puzzle) != BINARY_PUZZLE_OK) {
+            CHECK(!"batch puzzle parses");
+            continue;
+        }
+        CHECK(binary_puzzle_solve(puzzle, UINT16_MAX) == BINARY_PUZZLE_OK);
+        CHECK(binary_puzzle_check_unique(puzzle, &unique) == BINARY_PUZZLE_OK
+              && unique);
+        binary_puzzle_write_cells(puzzle, true, cells);
+        CHECK(strcmp(cells, solution) == 0);
+        binary_puzzle_destroy(puzzle);
+    }
+    return check_done("mixing");
+}
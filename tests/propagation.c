@@ -0,0 +1,57 @@
+#include "binary_puzzle.h"
+#include "check.h"
+#include <string.h>
+
+/* boards above the kernel sizes, where rounds are shared between threads */
+#define MAX_SIZE 20
+#define SEED_CT 2
+
+static const uint8_t sizes[] = {16, 20};
+static const uint8_t thread_cts[] = {2, 4};
+
+/**
+ * Generate the puzzle of `size` and `seed` on `thread_ct` threads, writing
+ * its puzzle and solution cells into `cells` and `solution`.
+ *
+ * Return `true` iff successful.
+ */
+static bool generate(uint8_t size, uint32_t seed, uint8_t thread_ct,
+                     char *cells, char *solution) {
+    binary_puzzle_options_t options;
+    BinaryPuzzle *puzzle;
+
+    binary_puzzle_options_init(&options, size, BINARY_PUZZLE_HARD);
+    options.seed = seed;
+    options.propagation_threads = thread_ct;
+    if (binary_puzzle_generate(&options, &puzzle) != BINARY_PUZZLE_OK)
+        return false;
+    binary_puzzle_write_cells(puzzle, false, cells);
+    binary_puzzle_write_cells(puzzle, true, solution);
+    binary_puzzle_destroy(puzzle);
+    return true;
+}
+
+int main(void) {
+    char cells[MAX_SIZE * MAX_SIZE + 1], solution[MAX_SIZE * MAX_SIZE + 1];
+    char shared_cells[MAX_SIZE * MAX_SIZE + 1];
+    char shared_solution[MAX_SIZE * MAX_SIZE + 1];
+    size_t s, t;
+    uint32_t seed;
+
+    /*
+     * rounds deduce from the board as it stood and merge in row-major order,
+     * so a seed gives the same puzzle on any number of threads
+     */
+    for (s = 0; s < sizeof(sizes); s++) {
+        for (seed = 1; seed <= SEED_CT; seed++) {
+            CHECK(generate(sizes[s], seed, 1, cells, solution));
+            for (t = 0; t < sizeof(thread_cts); t++) {
+                CHECK(generate(sizes[s], seed, thread_cts[t], shared_cells,
+                               shared_solution));
+                CHECK(strcmp(cells, shared_cells) == 0);
+                CHECK(strcmp(solution, shared_solution) == 0);
+            }
+        }
+    }
+    return check_done("propagation");
+}
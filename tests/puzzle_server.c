@@ -0,0 +1,192 @@
+#define _POSIX_C_SOURCE 200809L
+#include "binary_puzzle.h"
+#include "check.h"
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define PROGRAM "bin/puzzle_server"
+/* how long the server gets to start listening, and to exit once told */
+#define WAIT_MS 5000
+#define POLL_MS 10
+#define RESPONSE_SIZE 4096
+#define REQUEST_CT 7
+
+static const char *const requests = "6 easy\n"
+                                    "8 medium 7\n"
+                                    "10 hard\n"
+                                    "six easy\n"
+                                    "7 easy\n"
+                                    "6 extreme\n"
+                                    "8 medium 4294967296\n";
+
+static void sleep_ms(long ms) {
+    struct timespec pause;
+    pause.tv_sec = ms / 1000;
+    pause.tv_nsec = ms % 1000 * 1000000;
+    nanosleep(&pause, NULL);
+}
+
+/**
+ * Connect to the server at `address`, retrying while it starts.
+ *
+ * Return the socket, or -1 on failure.
+ */
+static int connect_server(const struct sockaddr_un *address) {
+    long waited_ms;
+    int fd;
+
+    for (waited_ms = 0; waited_ms < WAIT_MS; waited_ms += POLL_MS) {
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0)
+            return -1;
+        if (connect(fd, (const struct sockaddr *)address, sizeof(*address))
+            == 0)
+            return fd;
+        close(fd);
+        sleep_ms(POLL_MS);
+    }
+    return -1;
+}
+
+/**
+ * Read from `fd` into `out` until it holds `line_ct` lines or `fd` closes.
+ */
+static void read_lines(int fd, char *out, size_t size, size_t line_ct) {
+    size_t used = 0, seen_ct = 0, k;
+    ssize_t read_ct;
+
+    while (seen_ct < line_ct
+           && (read_ct = read(fd, out + used, size - 1 - used)) > 0) {
+        for (k = used; k < used + read_ct; k++) {
+            seen_ct += out[k] == '\n';
+        }
+        used += read_ct;
+    }
+    out[used] = '\0';
+}
+
+/**
+ * Return `true` iff `line` is `OK <puzzle> <solution>` for a board of
+ * `size`, with the solution matching every given cell.
+ */
+static bool answer_ok(const char *line, size_t size) {
+    const size_t cell_ct = size * size;
+    const char *cells = line + 3, *solution = line + 3 + cell_ct + 1;
+    size_t k;
+
+    if (strncmp(line, "OK ", 3) != 0 || strlen(line) != 3 + 2 * cell_ct + 1
+        || cells[cell_ct] != ' ')
+        return false;
+    for (k = 0; k < cell_ct; k++) {
+        if ((solution[k] != '0' && solution[k] != '1')
+            || (cells[k] != '.' && cells[k] != solution[k]))
+            return false;
+    }
+    return true;
+}
+
+/**
+ * Return `true` iff `line` is what the server should answer to a request
+ * for an 8 by 8 medium puzzle with seed 7.
+ */
+static bool answer_seeded(const char *line) {
+    binary_puzzle_options_t options;
+    BinaryPuzzle *puzzle;
+    char expected[3 + 2 * 64 + 2];
+    bool matches;
+
+    binary_puzzle_options_init(&options, 8, BINARY_PUZZLE_MEDIUM);
+    options.seed = 7;
+    if (binary_puzzle_generate(&options, &puzzle) != BINARY_PUZZLE_OK)
+        return false;
+    strcpy(expected, "OK ");
+    binary_puzzle_write_cells(puzzle, false, expected + 3);
+    expected[3 + 64] = ' ';
+    binary_puzzle_write_cells(puzzle, true, expected + 3 + 64 + 1);
+    matches = strcmp(line, expected) == 0;
+    binary_puzzle_destroy(puzzle);
+    return matches;
+}
+
+int main(void) {
+    char directory[] = "/tmp/puzzle_server_test_XXXXXX";
+    char response[RESPONSE_SIZE], *lines[REQUEST_CT], *line;
+    struct sockaddr_un address;
+    long waited_ms;
+    int fd, wait_status = 0;
+    size_t k;
+    pid_t pid;
+
+    if (mkdtemp(directory) == NULL) {
+        fprintf(stderr, "puzzle_server: failed to set up\n");
+        return 1;
+    }
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    sprintf(address.sun_path, "%s/server.sock", directory);
+
+    pid = fork();
+    if (pid == 0) {
+        execl(PROGRAM, PROGRAM, "-S", address.sun_path, "-w", "1", "-p", "2",
+              "-n", "6", "-l", "5000", (char *)NULL);
+        _exit(127);
+    }
+    CHECK(pid > 0);
+    fd = pid > 0 ? connect_server(&address) : -1;
+    CHECK(fd >= 0);
+
+    /*
+     * pipelined requests are answered in order, one line each, pooled ones
+     * under the time limit too
+     */
+    response[0] = '\0';
+    if (fd >= 0) {
+        CHECK(write(fd, requests, strlen(requests))
+              == (ssize_t)strlen(requests));
+        read_lines(fd, response, sizeof(response), REQUEST_CT);
+        close(fd);
+    }
+    line = response;
+    for (k = 0; k < REQUEST_CT; k++) {
+        lines[k] = line;
+        line = strchr(line, '\n');
+        if (line == NULL) {
+            line = "";
+        } else {
+            *line++ = '\0';
+        }
+    }
+    CHECK(answer_ok(lines[0], 6));
+    CHECK(answer_seeded(lines[1]));
+    CHECK(answer_ok(lines[2], 10));
+    CHECK(strncmp(lines[3], "ERR ", 4) == 0);
+    CHECK(strncmp(lines[4], "ERR ", 4) == 0);
+    CHECK(strncmp(lines[5], "ERR ", 4) == 0);
+    CHECK(strncmp(lines[6], "ERR ", 4) == 0);
+
+    /* shutdown interrupts the wait for connections */
+    if (pid > 0) {
+        kill(pid, SIGTERM);
+        for (waited_ms = 0;
+             waitpid(pid, &wait_status, WNOHANG) == 0 && waited_ms < WAIT_MS;
+             waited_ms += POLL_MS) {
+            sleep_ms(POLL_MS);
+        }
+        CHECK(waited_ms < WAIT_MS);
+        if (waited_ms >= WAIT_MS) {
+            kill(pid, SIGKILL);
+            waitpid(pid, &wait_status, 0);
+        }
+        CHECK(WIFEXITED(wait_status) && WEXITSTATUS(wait_status) == 0);
+        CHECK(access(address.sun_path, F_OK) != 0);
+    }
+    unlink(address.sun_path);
+    rmdir(directory);
+    return check_done("puzzle_server");
+}
@@ -0,0 +1,114 @@
+#define _POSIX_C_SOURCE 200809L
+#include "binary_puzzle.h"
+#include "check.h"
+#include <pthread.h>
+#include <stdlib.h>
+
+#define PUZZLE_CT 32
+/* slots in the one bucket of the smallest set */
+#define BUCKET_SLOTS 8
+#define RACE_THREADS 4
+#define RACE_ROUNDS 200
+
+typedef struct {
+    BinaryPuzzleSet *set;
+    const BinaryPuzzle *puzzle;
+    pthread_barrier_t *start;
+    bool inserted;
+} Racer;
+
+static void *race_insert(void *arg) {
+    Racer *racer = arg;
+    pthread_barrier_wait(racer->start);
+    racer->inserted = binary_puzzle_set_insert(racer->set, racer->puzzle);
+    return NULL;
+}
+
+/**
+ * Insert `puzzle` from several threads at once into a set whose only
+ * bucket is full, so they all go for the same slot.
+ *
+ * Return how many were told it was new.
+ */
+static size_t race(BinaryPuzzle **fillers, const BinaryPuzzle *puzzle) {
+    BinaryPuzzleSet *set = binary_puzzle_set_create(1);
+    Racer racers[RACE_THREADS];
+    pthread_t threads[RACE_THREADS];
+    pthread_barrier_t start;
+    size_t k, inserted_ct = 0;
+
+    if (set == NULL)
+        return 0;
+    for (k = 0; k < BUCKET_SLOTS; k++) {
+        binary_puzzle_set_insert(set, fillers[k]);
+    }
+    pthread_barrier_init(&start, NULL, RACE_THREADS);
+    for (k = 0; k < RACE_THREADS; k++) {
+        racers[k].set = set;
+        racers[k].puzzle = puzzle;
+        racers[k].start = &start;
+        racers[k].inserted = false;
+        pthread_create(&threads[k], NULL, race_insert, &racers[k]);
+    }
+    for (k = 0; k < RACE_THREADS; k++) {
+        pthread_join(threads[k], NULL);
+        inserted_ct += racers[k].inserted;
+    }
+    pthread_barrier_destroy(&start);
+    binary_puzzle_set_destroy(set);
+    return inserted_ct;
+}
+
+int main(void) {
+    binary_puzzle_options_t options;
+    BinaryPuzzle *puzzles[PUZZLE_CT];
+    BinaryPuzzle *variants[BINARY_PUZZLE_SYMMETRY_COUNT];
+    BinaryPuzzleSet *set;
+    size_t k, l, variant_ct;
+
+    binary_puzzle_options_init(&options, 8, BINARY_PUZZLE_MEDIUM);
+    options.seed = 1;
+    if (binary_puzzle_generate_batch(&options, puzzles, PUZZLE_CT)
+        != BINARY_PUZZLE_OK) {
+        fprintf(stderr, "puzzle_set: failed to generate puzzles\n");
+        return 1;
+    }
+
+    /* every puzzle is new once, and so are none of its variants after */
+    set = binary_puzzle_set_create(PUZZLE_CT);
+    CHECK(set != NULL);
+    for (k = 0; set != NULL && k < PUZZLE_CT; k++) {
+        CHECK(binary_puzzle_set_insert(set, puzzles[k]));
+        CHECK(!binary_puzzle_set_insert(set, puzzles[k]));
+        CHECK(binary_puzzle_variants(puzzles[k], variants, &variant_ct)
+              == BINARY_PUZZLE_OK);
+        for (l = 0; l < variant_ct; l++) {
+            CHECK(!binary_puzzle_set_insert(set, variants[l]));
+            binary_puzzle_destroy(variants[l]);
+        }
+    }
+    CHECK(set == NULL || binary_puzzle_set_get_count(set) == PUZZLE_CT);
+    binary_puzzle_set_destroy(set);
+
+    /* a full set forgets old puzzles but still knows the newest */
+    set = binary_puzzle_set_create(1);
+    CHECK(set != NULL);
+    for (k = 0; set != NULL && k < PUZZLE_CT; k++) {
+        CHECK(binary_puzzle_set_insert(set, puzzles[k]));
+        CHECK(!binary_puzzle_set_insert(set, puzzles[k]));
+    }
+    CHECK(set == NULL || binary_puzzle_set_get_count(set) == PUZZLE_CT);
+    binary_puzzle_set_destroy(set);
+
+    /* threads racing to overwrite a full bucket agree on who was first */
+    for (k = 0; k < RACE_ROUNDS; k++) {
+        CHECK(race(puzzles,
+                   puzzles[BUCKET_SLOTS + k % (PUZZLE_CT - BUCKET_SLOTS)])
+              == 1);
+    }
+
+    for (k = 0; k < PUZZLE_CT; k++) {
+        binary_puzzle_destroy(puzzles[k]);
+    }
+    return check_done("puzzle_set");
+}
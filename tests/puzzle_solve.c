@@ -0,0 +1,172 @@
+#define _POSIX_C_SOURCE 200809L
+#include "binary_puzzle.h"
+#include "check.h"
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define PROGRAM "bin/puzzle_solve"
+#define PUZZLE_CT 5
+#define SIZE 8
+#define CELL_CT (SIZE * SIZE)
+/* past the range of a signed header byte */
+#define LARGE_SIZE 130
+#define OUTPUT_SIZE 4096
+
+static char directory[] = "/tmp/puzzle_solve_test_XXXXXX";
+static char text_path[64], packed_path[64], bad_path[64];
+
+/**
+ * Run `command` through the shell, its stderr dropped, reading up to
+ * `size - 1` bytes of its stdout into `out`, null terminated.
+ *
+ * Return its exit status, or -1 if it could not be run.
+ */
+static int run(const char *command, char *out, size_t size) {
+    char line[512];
+    size_t used = 0, read_ct;
+    FILE *pipe;
+    int status;
+
+    snprintf(line, sizeof(line), "%s 2>/dev/null", command);
+    pipe = popen(line, "r");
+    if (pipe == NULL)
+        return -1;
+    while ((read_ct = fread(out + used, 1, size - 1 - used, pipe)) > 0) {
+        used += read_ct;
+    }
+    out[used] = '\0';
+    status = pclose(pipe);
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+/**
+ * Read up to `size` bytes of the file at `path` into `out`.
+ *
+ * Return how many were read.
+ */
+static size_t read_file(const char *path, unsigned char *out, size_t size) {
+    FILE *in = fopen(path, "rb");
+    size_t read_ct;
+
+    if (in == NULL)
+        return 0;
+    read_ct = fread(out, 1, size, in);
+    fclose(in);
+    return read_ct;
+}
+
+/**
+ * Return `true` iff `output` holds one `unique <solution> ...` line per
+ * entry of `solutions`, in order.
+ */
+static bool all_unique(const char *output, char solutions[][CELL_CT + 1]) {
+    const char *line = output;
+    size_t k;
+
+    for (k = 0; k < PUZZLE_CT; k++) {
+        if (strncmp(line, "unique ", 7) != 0
+            || strncmp(line + 7, solutions[k], CELL_CT) != 0
+            || line[7 + CELL_CT] != ' ')
+            return false;
+        line = strchr(line, '\n');
+        if (line == NULL)
+            return false;
+        line++;
+    }
+    return *line == '\0';
+}
+
+int main(void) {
+    binary_puzzle_options_t options;
+    BinaryPuzzle *puzzles[PUZZLE_CT];
+    char cells[PUZZLE_CT][CELL_CT + 1], solutions[PUZZLE_CT][CELL_CT + 1];
+    char command[256], output[OUTPUT_SIZE];
+    unsigned char packed[OUTPUT_SIZE];
+    size_t k, packed_len;
+    FILE *text;
+
+    binary_puzzle_options_init(&options, SIZE, BINARY_PUZZLE_MEDIUM);
+    options.seed = 3;
+    if (mkdtemp(directory) == NULL
+        || binary_puzzle_generate_batch(&options, puzzles, PUZZLE_CT)
+               != BINARY_PUZZLE_OK) {
+        fprintf(stderr, "puzzle_solve: failed to set up\n");
+        return 1;
+    }
+    sprintf(text_path, "%s/puzzles.txt", directory);
+    sprintf(packed_path, "%s/puzzles.bpz", directory);
+    sprintf(bad_path, "%s/bad.txt", directory);
+
+    /*
+     * lines as `binary_puzzle -b` prints them, one with a carriage return,
+     * the last holding only the puzzle, with blank lines skipped between
+     */
+    text = fopen(text_path, "w");
+    for (k = 0; text != NULL && k < PUZZLE_CT; k++) {
+        binary_puzzle_write_cells(puzzles[k], false, cells[k]);
+        binary_puzzle_write_cells(puzzles[k], true, solutions[k]);
+        if (k + 1 == PUZZLE_CT) {
+            fprintf(text, "%s\n", cells[k]);
+        } else {
+            fprintf(text, "%s %s%s\n%s", cells[k], solutions[k],
+                    k == 1 ? "\r" : "", k == 2 ? "\n\r\n" : "");
+        }
+    }
+    CHECK(text != NULL && fclose(text) == 0);
+
+    sprintf(command, PROGRAM " %s", text_path);
+    CHECK(run(command, output, sizeof(output)) == 0);
+    CHECK(all_unique(output, solutions));
+
+    /* the packed file holds the same puzzles */
+    sprintf(command, PROGRAM " -c %s > %s", text_path, packed_path);
+    CHECK(run(command, output, sizeof(output)) == 0);
+    packed_len = read_file(packed_path, packed, sizeof(packed));
+    CHECK(packed_len == 8 + PUZZLE_CT * 2 * ((CELL_CT + 7) / 8));
+    CHECK(memcmp(packed, "BPZP", 4) == 0 && packed[4] == 1
+          && packed[5] == SIZE && packed[6] == 0 && packed[7] == 0);
+    sprintf(command, PROGRAM " %s", packed_path);
+    CHECK(run(command, output, sizeof(output)) == 0);
+    CHECK(all_unique(output, solutions));
+
+    /* failed conversions write nothing */
+    text = fopen(bad_path, "w");
+    if (text != NULL) {
+        fprintf(text, "%s\n0101\n", cells[0]);
+        fclose(text);
+    }
+    sprintf(command, PROGRAM " -c %s", bad_path);
+    CHECK(run(command, output, sizeof(output)) != 0);
+    CHECK(output[0] == '\0');
+    text = fopen(bad_path, "w");
+    if (text != NULL) {
+        fprintf(text, "%s\n01\n", cells[0]);
+        fclose(text);
+    }
+    CHECK(run(command, output, sizeof(output)) != 0);
+    CHECK(output[0] == '\0');
+
+    /* sizes from 128 up are read back from the header */
+    text = fopen(text_path, "w");
+    for (k = 0; text != NULL && k < (size_t)LARGE_SIZE * LARGE_SIZE; k++) {
+        fputc('.', text);
+    }
+    CHECK(text != NULL && fputc('\n', text) == '\n' && fclose(text) == 0);
+    sprintf(command, PROGRAM " -c %s > %s", text_path, packed_path);
+    CHECK(run(command, output, sizeof(output)) == 0);
+    CHECK(read_file(packed_path, packed, 8) == 8 && packed[5] == LARGE_SIZE);
+    sprintf(command, PROGRAM " -q -g 0 %s", packed_path);
+    CHECK(run(command, output, sizeof(output)) == 0);
+    CHECK(strncmp(output, "too_hard - ", 11) == 0);
+
+    for (k = 0; k < PUZZLE_CT; k++) {
+        binary_puzzle_destroy(puzzles[k]);
+    }
+    unlink(text_path);
+    unlink(packed_path);
+    unlink(bad_path);
+    rmdir(directory);
+    return check_done("puzzle_solve");
+}
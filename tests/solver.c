@@ -0,0 +1,79 @@
+#include "binary_puzzle.h"
+#include "check.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* above the sizes with a kernel, so the generic guess heap is used */
+#define SIZE 16
+#define EMPTY_SIZE 18
+#define MAX_CELLS (EMPTY_SIZE * EMPTY_SIZE)
+#define PUZZLE_CT 6
+
+/**
+ * Solve the `size * size` row-major `cells` into `out`, null terminated.
+ *
+ * Return the status of the solve.
+ */
+static binary_puzzle_status_t solve(uint8_t size, const char *cells,
+                                    uint16_t allowed_guesses, bool *unique,
+                                    char *out) {
+    BinaryPuzzle *puzzle = NULL;
+    binary_puzzle_status_t status = binary_puzzle_parse(size, cells, &puzzle);
+
+    if (status == BINARY_PUZZLE_OK)
+        status = binary_puzzle_solve(puzzle, allowed_guesses);
+    if (status == BINARY_PUZZLE_OK && unique != NULL)
+        status = binary_puzzle_check_unique(puzzle, unique);
+    if (status == BINARY_PUZZLE_OK && out != NULL)
+        binary_puzzle_write_cells(puzzle, true, out);
+    binary_puzzle_destroy(puzzle);
+    return status;
+}
+
+int main(void) {
+    binary_puzzle_options_t options;
+    BinaryPuzzle *puzzles[PUZZLE_CT];
+    char cells[MAX_CELLS + 1], solution[MAX_CELLS + 1], solved[MAX_CELLS + 1];
+    size_t k;
+    bool unique;
+
+    /* generated puzzles solve back to their own solution, and only to it */
+    binary_puzzle_options_init(&options, SIZE, BINARY_PUZZLE_HARD);
+    options.seed = 9;
+    if (binary_puzzle_generate_batch(&options, puzzles, PUZZLE_CT)
+        != BINARY_PUZZLE_OK) {
+        fprintf(stderr, "solver: failed to generate puzzles\n");
+        return 1;
+    }
+    for (k = 0; k < PUZZLE_CT; k++) {
+        binary_puzzle_write_cells(puzzles[k], false, cells);
+        binary_puzzle_write_cells(puzzles[k], true, solution);
+        binary_puzzle_destroy(puzzles[k]);
+        CHECK(solve(SIZE, cells, UINT16_MAX, &unique, solved)
+              == BINARY_PUZZLE_OK);
+        CHECK(unique);
+        CHECK(strcmp(solved, solution) == 0);
+    }
+
+    /*
+     * an empty board takes guesses, which a limit of none refuses, and has
+     * many solutions; the one found keeps every rule once given in full
+     */
+    memset(cells, '.', EMPTY_SIZE * EMPTY_SIZE);
+    cells[EMPTY_SIZE * EMPTY_SIZE] = '\0';
+    CHECK(solve(EMPTY_SIZE, cells, 0, NULL, NULL)
+          == BINARY_PUZZLE_ERR_OUT_OF_GUESSES);
+    CHECK(solve(EMPTY_SIZE, cells, UINT16_MAX, &unique, solved)
+          == BINARY_PUZZLE_OK);
+    CHECK(!unique);
+    CHECK(strchr(solved, '.') == NULL);
+    CHECK(solve(EMPTY_SIZE, solved, 0, NULL, NULL) == BINARY_PUZZLE_OK);
+
+    /* three in a row among the givens cannot be solved */
+    memset(cells, '.', SIZE * SIZE);
+    cells[SIZE * SIZE] = '\0';
+    cells[0] = cells[1] = cells[2] = '1';
+    CHECK(solve(SIZE, cells, UINT16_MAX, NULL, NULL)
+          == BINARY_PUZZLE_ERR_UNSOLVABLE);
+    return check_done("solver");
+}
@@ -0,0 +1,415 @@
+#define _POSIX_C_SOURCE 200809L
+#include "binary_puzzle.h"
+#include "reporter.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/* percent a metric may worsen by before it counts as a regression */
+#define REGRESSION_THRESHOLD 25
+/* latencies closer to the baseline than this are timer noise */
+#define NOISE_FLOOR_US 200
+
+/*
+ * Seed corpus: puzzle `k` of a size is generated with seed `k`, for as many
+ * seeds as fit a few seconds per size. Results only compare between runs
+ * over the same corpus.
+ */
+typedef struct {
+    uint8_t size;
+    size_t seed_ct;
+} CorpusEntry;
+
+static const CorpusEntry corpus[] = {
+    {6, 2000}, {8, 2000}, {10, 500}, {12, 500}, {14, 200}, {16, 50},
+    {20, 20},  {24, 10},  {30, 4},   {40, 2},   {50, 1},   {60, 1},
+};
+
+static const char *const difficulty_names[] = {"easy", "medium", "hard"};
+
+typedef struct {
+    uint32_t p50;
+    uint32_t p95;
+    uint32_t p99;
+    uint32_t max;
+} Percentiles;
+
+typedef struct {
+    uint8_t size;
+    binary_puzzle_difficulty_t difficulty;
+    size_t count;
+    double puzzles_per_sec;
+    Percentiles total;
+    Percentiles solution;
+    Percentiles mask;
+} BenchResult;
+
+static void print_usage(const char *program) {
+    printf("usage: %s [-n sizes] [-c count] [-r repeats] [-o out] "
+           "[-b baseline] [-t percent]\n"
+           "\n"
+           "Generate the seed corpus for every size and difficulty and print "
+           "throughput\n"
+           "and per-phase latency percentiles as JSON.\n"
+           "\n"
+           "  -n sizes     comma separated sizes (default every size from 6 "
+           "to 60)\n"
+           "  -c count     seeds per size instead of the corpus' own count\n"
+           "  -r repeats   generate the corpus this many times, keeping each "
+           "puzzle's\n"
+           "               fastest run (default 1)\n"
+           "  -o out       write the JSON to `out` instead of stdout\n",
+           program);
+    printf("  -b baseline  compare against JSON written earlier, failing on "
+           "a regression\n"
+           "  -t percent   how much worse than the baseline counts as a "
+           "regression\n"
+           "               (default %d)\n",
+           REGRESSION_THRESHOLD);
+}
+
+static int compare_uint32(const void *a, const void *b) {
+    const uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+/**
+ * Return the percentiles of the `count` values in `values`, sorting them.
+ */
+static Percentiles percentiles(uint32_t *values, size_t count) {
+    Percentiles result;
+    qsort(values, count, sizeof(uint32_t), compare_uint32);
+    /* nearest rank */
+    result.p50 = values[(count * 50 + 99) / 100 - 1];
+    result.p95 = values[(count * 95 + 99) / 100 - 1];
+    result.p99 = values[(count * 99 + 99) / 100 - 1];
+    result.max = values[count - 1];
+    return result;
+}
+
+static uint32_t elapsed_us(const struct timespec *start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) * 1000000
+           + (now.tv_nsec - start->tv_nsec) / 1000;
+}
+
+/**
+ * Generate `count` puzzles of one size and difficulty `repeat_ct` times into
+ * `result`, keeping each puzzle's fastest run to shed scheduler noise.
+ *
+ * Return `true` iff successful.
+ */
+static bool bench_run(uint8_t size, binary_puzzle_difficulty_t difficulty,
+                      size_t count, size_t repeat_ct, BenchResult *result) {
+    binary_puzzle_options_t options;
+    binary_puzzle_stats_t stats;
+    binary_puzzle_status_t status = BINARY_PUZZLE_OK;
+    BinaryPuzzle *puzzle;
+    struct timespec start;
+    double total_us = 0;
+    uint32_t latency_us;
+    size_t k, r;
+    uint32_t *total = malloc(count * sizeof(uint32_t));
+    uint32_t *solution = malloc(count * sizeof(uint32_t));
+    uint32_t *mask = malloc(count * sizeof(uint32_t));
+    if (total == NULL || solution == NULL || mask == NULL) {
+        report_system_error("memory allocation failure");
+        free(total);
+        free(solution);
+        free(mask);
+        return false;
+    }
+
+    binary_puzzle_options_init(&options, size, difficulty);
+    for (r = 0; r < repeat_ct && status == BINARY_PUZZLE_OK; r++) {
+        for (k = 0; k < count && status == BINARY_PUZZLE_OK; k++) {
+            options.seed = k;
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            status = binary_puzzle_generate(&options, &puzzle);
+            latency_us = elapsed_us(&start);
+            if (status == BINARY_PUZZLE_OK) {
+                if (r == 0 || latency_us < total[k]) {
+                    binary_puzzle_get_stats(puzzle, &stats);
+                    total[k] = latency_us;
+                    solution[k] = stats.solution_us;
+                    mask[k] = stats.mask_us;
+                }
+                binary_puzzle_destroy(puzzle);
+            }
+        }
+    }
+    for (k = 0; k < count; k++) {
+        total_us += total[k];
+    }
+
+    if (status == BINARY_PUZZLE_OK) {
+        result->size = size;
+        result->difficulty = difficulty;
+        result->count = count;
+        result->puzzles_per_sec = total_us > 0 ? count * 1e6 / total_us : 0;
+        result->total = percentiles(total, count);
+        result->solution = percentiles(solution, count);
+        result->mask = percentiles(mask, count);
+    } else {
+        report_system_error(binary_puzzle_status_string(status));
+    }
+    free(total);
+    free(solution);
+    free(mask);
+    return status == BINARY_PUZZLE_OK;
+}
+
+/* field order shared by `print_result` and `read_result` */
+#define RESULT_FORMAT                                                          \
+    "{\"size\": %u, \"difficulty\": \"%s\", \"count\": %lu, "                  \
+    "\"puzzles_per_sec\": %.1f, "                                              \
+    "\"total_us\": {\"p50\": %lu, \"p95\": %lu, \"p99\": %lu, \"max\": %lu}, " \
+    "\"solution_us\": {\"p50\": %lu, \"p95\": %lu, \"p99\": %lu, "             \
+    "\"max\": %lu}, "                                                          \
+    "\"mask_us\": {\"p50\": %lu, \"p95\": %lu, \"p99\": %lu, \"max\": %lu}}"
+
+static void print_result(FILE *out, const BenchResult *result) {
+    fprintf(out, RESULT_FORMAT, (unsigned)result->size,
+            difficulty_names[result->difficulty], (unsigned long)result->count,
+            result->puzzles_per_sec, (unsigned long)result->total.p50,
+            (unsigned long)result->total.p95, (unsigned long)result->total.p99,
+            (unsigned long)result->total.max,
+            (unsigned long)result->solution.p50,
+            (unsigned long)result->solution.p95,
+            (unsigned long)result->solution.p99,
+            (unsigned long)result->solution.max,
+            (unsigned long)result->mask.p50, (unsigned long)result->mask.p95,
+            (unsigned long)result->mask.p99, (unsigned long)result->mask.max);
+}
+
+/**
+ * Parse a line written by `print_result` into `result`, ignoring the phase
+ * percentiles.
+ *
+ * Return `true` iff successful.
+ */
+static bool read_result(const char *line, BenchResult *result) {
+    char difficulty[16];
+    unsigned size;
+    unsigned long count, p50, p95, p99, max;
+    size_t d;
+
+    while (*line == ' ' || *line == ',') {
+        line++;
+    }
+    if (sscanf(line,
+               "{\"size\": %u, \"difficulty\": \"%15[a-z]\", \"count\": %lu, "
+               "\"puzzles_per_sec\": %lf, \"total_us\": {\"p50\": %lu, "
+               "\"p95\": %lu, \"p99\": %lu, \"max\": %lu}",
+               &size, difficulty, &count, &result->puzzles_per_sec, &p50, &p95,
+               &p99, &max)
+        != 8) {
+        return false;
+    }
+    for (d = 0; d <= BINARY_PUZZLE_HARD; d++) {
+        if (strcmp(difficulty, difficulty_names[d]) == 0) {
+            result->size = size;
+            result->difficulty = d;
+            result->count = count;
+            result->total.p50 = p50;
+            result->total.p95 = p95;
+            result->total.p99 = p99;
+            result->total.max = max;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Return `true` iff latency `value` is worse than `baseline` by more than
+ * `threshold` percent and the noise floor.
+ */
+static bool latency_regressed(uint32_t value, uint32_t baseline,
+                              unsigned long threshold) {
+    return value > baseline + NOISE_FLOOR_US
+           && value * 100.0 > baseline * (100.0 + threshold);
+}
+
+/**
+ * Compare `results` against the baseline file at `path`, reporting every
+ * regression on stderr. Results without a baseline over the same corpus are
+ * skipped.
+ *
+ * Return the number of regressions, or -1 if the baseline cannot be read.
+ */
+static long compare_baseline(const char *path, const BenchResult *results,
+                             size_t result_ct, unsigned long threshold) {
+    BenchResult baseline;
+    char line[1024];
+    const BenchResult *result;
+    long regression_ct = 0;
+    size_t k;
+    FILE *file = fopen(path, "r");
+    if (file == NULL)
+        return -1;
+
+    while (fgets(line, sizeof(line), file) != NULL) {
+        if (!read_result(line, &baseline))
+            continue;
+        for (k = 0; k < result_ct; k++) {
+            result = &results[k];
+            if (result->size != baseline.size
+                || result->difficulty != baseline.difficulty
+                || result->count != baseline.count)
+                continue;
+            if (result->puzzles_per_sec * (100.0 + threshold)
+                    < baseline.puzzles_per_sec * 100.0
+                || latency_regressed(result->total.p50, baseline.total.p50,
+                                     threshold)
+                /* tails rest on a handful of puzzles, so allow them more */
+                || latency_regressed(result->total.p95, baseline.total.p95,
+                                     2 * threshold)
+                || latency_regressed(result->total.p99, baseline.total.p99,
+                                     2 * threshold)) {
+                fprintf(stderr,
+                        "regression: size %u %s: %.1f puzzles/s, p50/p95/p99 "
+                        "%lu/%lu/%lu us (baseline %.1f puzzles/s, %lu/%lu/%lu "
+                        "us)\n",
+                        (unsigned)result->size,
+                        difficulty_names[result->difficulty],
+                        result->puzzles_per_sec,
+                        (unsigned long)result->total.p50,
+                        (unsigned long)result->total.p95,
+                        (unsigned long)result->total.p99,
+                        baseline.puzzles_per_sec,
+                        (unsigned long)baseline.total.p50,
+                        (unsigned long)baseline.total.p95,
+                        (unsigned long)baseline.total.p99);
+                regression_ct++;
+            }
+        }
+    }
+    fclose(file);
+    return regression_ct;
+}
+
+/**
+ * Return the corpus' seed count for `size`, or 0 if it has none.
+ */
+static size_t corpus_seed_ct(unsigned long size) {
+    size_t k;
+    for (k = 0; k < sizeof(corpus) / sizeof(corpus[0]); k++) {
+        if (corpus[k].size == size) {
+            return corpus[k].seed_ct;
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    const char *sizes = NULL, *out_path = NULL, *baseline_path = NULL;
+    unsigned long threshold = REGRESSION_THRESHOLD, size;
+    size_t seed_ct = 0, repeat_ct = 1, result_ct = 0, k, count;
+    BenchResult results[sizeof(corpus) / sizeof(corpus[0])
+                        * (BINARY_PUZZLE_HARD + 1)];
+    uint8_t run_sizes[sizeof(corpus) / sizeof(corpus[0])];
+    size_t run_size_ct = 0;
+    char *end;
+    int d, opt;
+    long regression_ct;
+    FILE *out = stdout;
+
+    while ((opt = getopt(argc, argv, "n:c:r:o:b:t:h")) != -1) {
+        switch (opt) {
+        case 'n':
+            sizes = optarg;
+            break;
+        case 'c':
+            seed_ct = strtoul(optarg, NULL, 10);
+            break;
+        case 'r':
+            repeat_ct = strtoul(optarg, NULL, 10);
+            break;
+        case 'o':
+            out_path = optarg;
+            break;
+        case 'b':
+            baseline_path = optarg;
+            break;
+        case 't':
+            threshold = strtoul(optarg, NULL, 10);
+            break;
+        case 'h':
+            print_usage(argv[0]);
+            return 0;
+        default:
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (sizes == NULL) {
+        for (k = 0; k < sizeof(corpus) / sizeof(corpus[0]); k++) {
+            run_sizes[run_size_ct++] = corpus[k].size;
+        }
+    } else {
+        while (*sizes != '\0') {
+            size = strtoul(sizes, &end, 10);
+            if (end == sizes || corpus_seed_ct(size) == 0
+                || run_size_ct == sizeof(run_sizes)) {
+                report_error("sizes must be a comma separated list of corpus "
+                             "sizes: 6, 8, 10, 12, 14, 16, 20, 24, 30, 40, 50 "
+                             "and 60");
+                return 1;
+            }
+            run_sizes[run_size_ct++] = size;
+            sizes = *end == ',' ? end + 1 : end;
+        }
+    }
+
+    if (repeat_ct == 0) {
+        report_error("repeats must be positive");
+        return 1;
+    }
+
+    for (k = 0; k < run_size_ct; k++) {
+        count = seed_ct > 0 ? seed_ct : corpus_seed_ct(run_sizes[k]);
+        for (d = BINARY_PUZZLE_EASY; d <= BINARY_PUZZLE_HARD; d++) {
+            fprintf(stderr, "size %u %s: %lu puzzles\n", (unsigned)run_sizes[k],
+                    difficulty_names[d], (unsigned long)count);
+            if (!bench_run(run_sizes[k], d, count, repeat_ct,
+                           &results[result_ct])) {
+                return 1;
+            }
+            result_ct++;
+        }
+    }
+
+    if (out_path != NULL && (out = fopen(out_path, "w")) == NULL) {
+        report_system_error("failed to open output file");
+        return 1;
+    }
+    fprintf(out, "{\"results\": [\n");
+    for (k = 0; k < result_ct; k++) {
+        fprintf(out, "  ");
+        print_result(out, &results[k]);
+        fprintf(out, k + 1 < result_ct ? ",\n" : "\n");
+    }
+    fprintf(out, "]}\n");
+    if (out != stdout && fclose(out) != 0) {
+        report_system_error("failed to write output file");
+        return 1;
+    }
+
+    if (baseline_path != NULL) {
+        regression_ct
+            = compare_baseline(baseline_path, results, result_ct, threshold);
+        if (regression_ct < 0) {
+            report_system_error("failed to read baseline file");
+            return 1;
+        }
+        if (regression_ct > 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,197 @@
+#define _POSIX_C_SOURCE 200809L
+#include "reporter.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#define SOCKET_PATH "binary_puzzle.sock"
+#define CLIENT_CT 8
+#define REQUEST_CT 1000
+#define BOARD_SIZE 10
+/* longest answer: `OK `, two boards of 254 * 254 cells, a space and `\n` */
+#define RESPONSE_MAX (2 * 254 * 254 + 6)
+
+typedef struct {
+    const char *socket_path;
+    const char *request;
+    size_t request_ct;
+    /* round trip of every request, in microseconds */
+    uint32_t *latencies;
+    size_t error_ct;
+    bool failed;
+} Client;
+
+static void print_usage(const char *program) {
+    printf("usage: %s [-S socket] [-c clients] [-r requests] [-n size] "
+           "[-d difficulty]\n"
+           "\n"
+           "Load test `puzzle_server`: every client connects once and sends "
+           "its requests\n"
+           "one at a time, then round trip percentiles are printed.\n"
+           "\n"
+           "  -S socket      path the server listens on (default %s)\n"
+           "  -c clients     concurrent connections (default %d)\n"
+           "  -r requests    requests per connection (default %d)\n"
+           "  -n size        side length asked for (default %d)\n"
+           "  -d difficulty  easy, medium or hard (default medium)\n",
+           program, SOCKET_PATH, CLIENT_CT, REQUEST_CT, BOARD_SIZE);
+}
+
+static uint32_t elapsed_us(const struct timespec *start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) * 1000000
+           + (now.tv_nsec - start->tv_nsec) / 1000;
+}
+
+/**
+ * Send the requests of one client, timing each answer.
+ */
+static void *client_run(void *arg) {
+    Client *client = arg;
+    struct sockaddr_un address;
+    struct timespec start;
+    char *response = malloc(RESPONSE_MAX + 1);
+    FILE *in = NULL;
+    size_t k;
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, client->socket_path,
+            sizeof(address.sun_path) - 1);
+    if (response == NULL || fd < 0
+        || connect(fd, (struct sockaddr *)&address, sizeof(address)) != 0
+        || (in = fdopen(fd, "r")) == NULL) {
+        client->failed = true;
+        goto client_run_done;
+    }
+
+    for (k = 0; k < client->request_ct; k++) {
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        if (write(fd, client->request, strlen(client->request)) < 0
+            || fgets(response, RESPONSE_MAX + 1, in) == NULL) {
+            client->failed = true;
+            break;
+        }
+        client->latencies[k] = elapsed_us(&start);
+        if (strncmp(response, "OK ", 3) != 0)
+            client->error_ct++;
+    }
+
+client_run_done:
+    if (in != NULL) {
+        fclose(in);
+    } else if (fd >= 0) {
+        close(fd);
+    }
+    free(response);
+    return NULL;
+}
+
+static int compare_uint32(const void *a, const void *b) {
+    const uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+int main(int argc, char **argv) {
+    const char *socket_path = SOCKET_PATH, *difficulty = "medium";
+    size_t client_ct = CLIENT_CT, request_ct = REQUEST_CT, total_ct, k;
+    size_t error_ct = 0;
+    unsigned long size = BOARD_SIZE;
+    char request[32];
+    Client *clients;
+    pthread_t *threads;
+    uint32_t *latencies;
+    struct timespec start;
+    double seconds;
+    int opt, exit_code = 0;
+
+    while ((opt = getopt(argc, argv, "S:c:r:n:d:h")) != -1) {
+        switch (opt) {
+        case 'S':
+            socket_path = optarg;
+            break;
+        case 'c':
+            client_ct = strtoul(optarg, NULL, 10);
+            break;
+        case 'r':
+            request_ct = strtoul(optarg, NULL, 10);
+            break;
+        case 'n':
+            size = strtoul(optarg, NULL, 10);
+            break;
+        case 'd':
+            difficulty = optarg;
+            break;
+        case 'h':
+            print_usage(argv[0]);
+            return 0;
+        default:
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (client_ct == 0 || request_ct == 0 || strlen(difficulty) > 8) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    sprintf(request, "%lu %s\n", size, difficulty);
+
+    total_ct = client_ct * request_ct;
+    clients = calloc(client_ct, sizeof(Client));
+    threads = malloc(client_ct * sizeof(pthread_t));
+    latencies = malloc(total_ct * sizeof(uint32_t));
+    if (clients == NULL || threads == NULL || latencies == NULL) {
+        report_system_error("memory allocation failure");
+        exit_code = 1;
+        goto main_done;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (k = 0; k < client_ct; k++) {
+        clients[k].socket_path = socket_path;
+        clients[k].request = request;
+        clients[k].request_ct = request_ct;
+        clients[k].latencies = latencies + k * request_ct;
+        if (pthread_create(&threads[k], NULL, client_run, &clients[k]) != 0) {
+            report_system_error("failed to start a client thread");
+            exit(1);
+        }
+    }
+    for (k = 0; k < client_ct; k++) {
+        pthread_join(threads[k], NULL);
+        if (clients[k].failed) {
+            report_system_error("a client lost its connection");
+            exit_code = 1;
+            goto main_done;
+        }
+        error_ct += clients[k].error_ct;
+    }
+    seconds = elapsed_us(&start) / 1e6;
+
+    qsort(latencies, total_ct, sizeof(uint32_t), compare_uint32);
+    printf("%lu requests in %.2f s, %.0f requests/s, %lu errors\n",
+           (unsigned long)total_ct, seconds, total_ct / seconds,
+           (unsigned long)error_ct);
+    printf("round trip us: p50 %lu, p95 %lu, p99 %lu, max %lu\n",
+           (unsigned long)latencies[(total_ct * 50 + 99) / 100 - 1],
+           (unsigned long)latencies[(total_ct * 95 + 99) / 100 - 1],
+           (unsigned long)latencies[(total_ct * 99 + 99) / 100 - 1],
+           (unsigned long)latencies[total_ct - 1]);
+    if (error_ct > 0)
+        exit_code = 1;
+
+main_done:
+    free(clients);
+    free(threads);
+    free(latencies);
+    return exit_code;
+}
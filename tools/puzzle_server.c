@@ -0,0 +1,547 @@
+#define _POSIX_C_SOURCE 200809L
+#include "binary_puzzle.h"
+#include "reporter.h"
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#define SOCKET_PATH "binary_puzzle.sock"
+/* puzzles kept ready for every warm size and difficulty */
+#define POOL_TARGET 64
+#define WARM_SIZES "6,8,10,12,14"
+/* puzzles generated together, one batch of vector lanes */
+#define REFILL_CHUNK 16
+#define MAX_SIZE 254
+#define REQUEST_BUFFER_SIZE 4096
+#define DIFFICULTY_CT (BINARY_PUZZLE_HARD + 1)
+
+/*
+ * Protocol: one request per line, `<size> <difficulty> [seed]`, answered in
+ * order by one line each, `OK <puzzle> <solution>` in the format of
+ * `binary_puzzle -b` or `ERR <reason>`. Requests with a seed are generated
+ * on the spot, as `binary_puzzle_generate` would with that seed; the rest
+ * come from a pool.
+ */
+
+/* puzzles of one size and difficulty, generated ahead of requests */
+typedef struct {
+    uint8_t size;
+    binary_puzzle_difficulty_t difficulty;
+    BinaryPuzzle **puzzles;
+    size_t count;
+    size_t capacity;
+    /* puzzles kept ready, 0 for pools only filled on demand */
+    size_t target;
+    /* requests waiting for a puzzle, and puzzles being generated */
+    size_t waiting_ct;
+    size_t pending_ct;
+    /* batches that failed so far, and how the last one did */
+    unsigned long failure_ct;
+    binary_puzzle_status_t failure;
+    pthread_cond_t ready;
+} Pool;
+
+typedef struct {
+    /* guards every pool */
+    pthread_mutex_t lock;
+    /* signalled when a pool falls short */
+    pthread_cond_t work;
+    Pool *pools[MAX_SIZE / 2 + 1][DIFFICULTY_CT];
+    /* seed of the next pooled puzzle */
+    uint32_t next_seed;
+    /* milliseconds a seeded request may take, 0 for no limit */
+    uint32_t time_budget_ms;
+} Server;
+
+static const char *const difficulty_names[] = {"easy", "medium", "hard"};
+
+static volatile sig_atomic_t stopping = 0;
+
+static void print_usage(const char *program) {
+    printf("usage: %s [-S socket] [-w workers] [-p count] [-n sizes] [-l ms]\n"
+           "\n"
+           "Serve puzzles over a Unix domain socket, one `<size> <difficulty> "
+           "[seed]`\n"
+           "request per line, each answered by `OK <puzzle> <solution>` or "
+           "`ERR <reason>`.\n"
+           "\n"
+           "  -S socket   path to listen on (default %s)\n"
+           "  -w workers  generator threads (default one per CPU)\n",
+           program, SOCKET_PATH);
+    printf("  -p count    puzzles kept ready per size and difficulty "
+           "(default %d)\n"
+           "  -n sizes    comma separated sizes kept ready (default %s); "
+           "other sizes\n"
+           "              are generated as requested\n"
+           "  -l ms       time limit for generating each puzzle, pooled ones "
+           "then made\n"
+           "              one at a time; one cut short while hiding cells "
+           "has fewer\n"
+           "              hidden\n",
+           POOL_TARGET, WARM_SIZES);
+}
+
+static void stop(int signal) {
+    (void)signal;
+    stopping = 1;
+}
+
+/**
+ * Return the pool for `size` and `difficulty`, creating it with `target` if
+ * it does not exist. `server->lock` must be held.
+ *
+ * Return `NULL` on failure.
+ */
+static Pool *server_get_pool(Server *server, uint8_t size,
+                             binary_puzzle_difficulty_t difficulty,
+                             size_t target) {
+    Pool **pool = &server->pools[size / 2][difficulty];
+    if (*pool != NULL)
+        return *pool;
+
+    *pool = calloc(1, sizeof(Pool));
+    if (*pool == NULL)
+        return NULL;
+    (*pool)->size = size;
+    (*pool)->difficulty = difficulty;
+    (*pool)->target = target;
+    pthread_cond_init(&(*pool)->ready, NULL);
+    return *pool;
+}
+
+/**
+ * Return how many more puzzles `pool` should have generated for it.
+ */
+static size_t pool_shortfall(const Pool *pool) {
+    const size_t wanted = pool->target + pool->waiting_ct;
+    const size_t have = pool->count + pool->pending_ct;
+    return wanted > have ? wanted - have : 0;
+}
+
+/**
+ * Return the pool most short of puzzles, or `NULL` if none is.
+ * `server->lock` must be held.
+ */
+static Pool *server_neediest_pool(Server *server) {
+    Pool *pool, *neediest = NULL;
+    size_t k, d;
+    for (k = 0; k <= MAX_SIZE / 2; k++) {
+        for (d = 0; d < DIFFICULTY_CT; d++) {
+            pool = server->pools[k][d];
+            /* waiting requests go first, then pools furthest from full */
+            if (pool != NULL && pool_shortfall(pool) > 0
+                && (neediest == NULL
+                    || (pool->waiting_ct > 0) > (neediest->waiting_ct > 0)
+                    || ((pool->waiting_ct > 0) == (neediest->waiting_ct > 0)
+                        && pool_shortfall(pool) > pool_shortfall(neediest)))) {
+                neediest = pool;
+            }
+        }
+    }
+    return neediest;
+}
+
+/**
+ * Add the `count` puzzles in `puzzles` to `pool`. `server->lock` must be
+ * held.
+ *
+ * Return `true` iff successful.
+ */
+static bool pool_push(Pool *pool, BinaryPuzzle **puzzles, size_t count) {
+    size_t capacity = pool->capacity == 0 ? REFILL_CHUNK : pool->capacity;
+    void *grown;
+    while (capacity < pool->count + count) {
+        capacity *= 2;
+    }
+    if (capacity != pool->capacity) {
+        grown = realloc(pool->puzzles, capacity * sizeof(BinaryPuzzle *));
+        if (grown == NULL)
+            return false;
+        pool->puzzles = grown;
+        pool->capacity = capacity;
+    }
+    memcpy(pool->puzzles + pool->count, puzzles,
+           count * sizeof(BinaryPuzzle *));
+    pool->count += count;
+    return true;
+}
+
+/**
+ * Refill pools for as long as the server runs, a batch at a time.
+ */
+static void *server_worker_run(void *arg) {
+    Server *server = arg;
+    BinaryPuzzle *puzzles[REFILL_CHUNK];
+    binary_puzzle_options_t options;
+    binary_puzzle_status_t status;
+    Pool *pool;
+    size_t chunk_ct, k;
+
+    pthread_mutex_lock(&server->lock);
+    for (;;) {
+        while ((pool = server_neediest_pool(server)) == NULL) {
+            pthread_cond_wait(&server->work, &server->lock);
+        }
+        chunk_ct = pool_shortfall(pool);
+        if (chunk_ct > REFILL_CHUNK)
+            chunk_ct = REFILL_CHUNK;
+        /* batches take no time limit, so limited puzzles come one by one */
+        if (server->time_budget_ms != 0)
+            chunk_ct = 1;
+        pool->pending_ct += chunk_ct;
+        binary_puzzle_options_init(&options, pool->size, pool->difficulty);
+        options.seed = server->next_seed;
+        options.time_budget_ms = server->time_budget_ms;
+        server->next_seed += chunk_ct;
+        pthread_mutex_unlock(&server->lock);
+
+        if (options.time_budget_ms != 0) {
+            status = binary_puzzle_generate(&options, puzzles);
+            if (status == BINARY_PUZZLE_TRUNCATED)
+                status = BINARY_PUZZLE_OK;
+        } else {
+            status = binary_puzzle_generate_batch(&options, puzzles, chunk_ct);
+        }
+
+        pthread_mutex_lock(&server->lock);
+        pool->pending_ct -= chunk_ct;
+        if (status == BINARY_PUZZLE_OK && !pool_push(pool, puzzles, chunk_ct)) {
+            for (k = 0; k < chunk_ct; k++) {
+                binary_puzzle_destroy(puzzles[k]);
+            }
+            status = BINARY_PUZZLE_ERR_NO_MEMORY;
+        }
+        if (status != BINARY_PUZZLE_OK) {
+            report_system_error(binary_puzzle_status_string(status));
+            /* requests waiting on the pool are answered with the failure */
+            pool->failure_ct++;
+            pool->failure = status;
+            pthread_cond_broadcast(&pool->ready);
+            /* leave the pool for now rather than spin on the failure */
+            pthread_mutex_unlock(&server->lock);
+            sleep(1);
+            pthread_mutex_lock(&server->lock);
+            continue;
+        }
+        pthread_cond_broadcast(&pool->ready);
+    }
+    return NULL;
+}
+
+/**
+ * Take a puzzle of `size` and `difficulty` from its pool into `out`, waiting
+ * for one to be generated if the pool is empty.
+ *
+ * Return the status of the batch that failed if the pool is still empty
+ * after one does.
+ */
+static binary_puzzle_status_t server_take(Server *server, uint8_t size,
+                                          binary_puzzle_difficulty_t difficulty,
+                                          BinaryPuzzle **out) {
+    Pool *pool;
+    unsigned long failure_ct;
+
+    pthread_mutex_lock(&server->lock);
+    pool = server_get_pool(server, size, difficulty, 0);
+    if (pool == NULL) {
+        pthread_mutex_unlock(&server->lock);
+        return BINARY_PUZZLE_ERR_NO_MEMORY;
+    }
+    if (pool->count == 0) {
+        /* requests that pile up here are served by the same batches */
+        pool->waiting_ct++;
+        pthread_cond_signal(&server->work);
+        failure_ct = pool->failure_ct;
+        while (pool->count == 0 && pool->failure_ct == failure_ct) {
+            pthread_cond_wait(&pool->ready, &server->lock);
+        }
+        pool->waiting_ct--;
+        if (pool->count == 0) {
+            pthread_mutex_unlock(&server->lock);
+            return pool->failure;
+        }
+    }
+    *out = pool->puzzles[--pool->count];
+    if (pool_shortfall(pool) > 0) {
+        pthread_cond_signal(&server->work);
+    }
+    pthread_mutex_unlock(&server->lock);
+    return BINARY_PUZZLE_OK;
+}
+
+static bool parse_difficulty(const char *name,
+                             binary_puzzle_difficulty_t *difficulty) {
+    size_t d;
+    for (d = 0; d < DIFFICULTY_CT; d++) {
+        if (strcmp(name, difficulty_names[d]) == 0) {
+            *difficulty = d;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Answer the request in `line` on `out`.
+ */
+static void server_answer(Server *server, const char *line, char *cells,
+                          char *solution, FILE *out) {
+    binary_puzzle_options_t options;
+    binary_puzzle_difficulty_t difficulty;
+    binary_puzzle_status_t status = BINARY_PUZZLE_OK;
+    BinaryPuzzle *puzzle;
+    char difficulty_name[16];
+    unsigned size;
+    unsigned long seed;
+    int field_ct;
+
+    field_ct = sscanf(line, "%u %15s %lu", &size, difficulty_name, &seed);
+    if (field_ct < 2 || size < 2 || size > MAX_SIZE || size % 2 != 0
+        || (field_ct == 3 && seed > UINT32_MAX)) {
+        fprintf(out, "ERR expected `<size> <difficulty> [seed]` with an even "
+                     "size from 2 to %d and a seed below 2^32\n",
+                MAX_SIZE);
+        return;
+    }
+    if (!parse_difficulty(difficulty_name, &difficulty)) {
+        fprintf(out, "ERR difficulty must be easy, medium or hard\n");
+        return;
+    }
+
+    if (field_ct == 3) {
+        binary_puzzle_options_init(&options, size, difficulty);
+        options.seed = seed;
+        options.time_budget_ms = server->time_budget_ms;
+        status = binary_puzzle_generate(&options, &puzzle);
+        if (status == BINARY_PUZZLE_TRUNCATED)
+            status = BINARY_PUZZLE_OK;
+    } else {
+        status = server_take(server, size, difficulty, &puzzle);
+    }
+    if (status != BINARY_PUZZLE_OK) {
+        fprintf(out, "ERR %s\n", binary_puzzle_status_string(status));
+        return;
+    }
+    binary_puzzle_write_cells(puzzle, false, cells);
+    binary_puzzle_write_cells(puzzle, true, solution);
+    fprintf(out, "OK %s %s\n", cells, solution);
+    binary_puzzle_destroy(puzzle);
+}
+
+typedef struct {
+    Server *server;
+    int fd;
+} Connection;
+
+/**
+ * Answer the requests of one client until it hangs up.
+ */
+static void *connection_run(void *arg) {
+    Connection *connection = arg;
+    const size_t cell_ct = (size_t)MAX_SIZE * MAX_SIZE + 1;
+    char buffer[REQUEST_BUFFER_SIZE], *line, *newline;
+    size_t used = 0;
+    ssize_t read_ct;
+    char *cells = malloc(cell_ct), *solution = malloc(cell_ct);
+    FILE *out = fdopen(connection->fd, "w");
+
+    if (cells == NULL || solution == NULL || out == NULL) {
+        report_system_error("failed to set up a connection");
+        goto connection_run_done;
+    }
+    while ((read_ct = read(connection->fd, buffer + used,
+                           sizeof(buffer) - 1 - used))
+           > 0) {
+        used += read_ct;
+        buffer[used] = '\0';
+        for (line = buffer; (newline = strchr(line, '\n')) != NULL;
+             line = newline + 1) {
+            *newline = '\0';
+            server_answer(connection->server, line, cells, solution, out);
+        }
+        used -= line - buffer;
+        memmove(buffer, line, used);
+        if (used == sizeof(buffer) - 1) {
+            fprintf(out, "ERR request too long\n");
+            used = 0;
+        }
+        /* pipelined requests read together are answered in one write */
+        if (fflush(out) != 0)
+            break;
+    }
+
+connection_run_done:
+    if (out != NULL) {
+        fclose(out);
+    } else {
+        close(connection->fd);
+    }
+    free(cells);
+    free(solution);
+    free(connection);
+    return NULL;
+}
+
+/**
+ * Create pools of `target` puzzles for every size in the comma separated
+ * list `sizes`.
+ *
+ * Return `true` iff successful.
+ */
+static bool server_warm(Server *server, const char *sizes, size_t target) {
+    unsigned long size;
+    char *end;
+    size_t d;
+
+    while (*sizes != '\0') {
+        size = strtoul(sizes, &end, 10);
+        if (end == sizes || size < 2 || size > MAX_SIZE || size % 2 != 0) {
+            report_error("sizes must be a comma separated list of even "
+                         "numbers from 2 to 254");
+            return false;
+        }
+        for (d = 0; d < DIFFICULTY_CT; d++) {
+            if (server_get_pool(server, size, d, target) == NULL) {
+                report_system_error("memory allocation failure");
+                return false;
+            }
+        }
+        sizes = *end == ',' ? end + 1 : end;
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    const char *socket_path = SOCKET_PATH, *sizes = WARM_SIZES;
+    long worker_ct = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t target = POOL_TARGET;
+    struct sockaddr_un address;
+    struct sigaction action;
+    sigset_t shutdown_signals, accept_mask;
+    fd_set listen_set;
+    Server server;
+    Connection *connection;
+    pthread_t thread;
+    pthread_attr_t detached;
+    int opt, listen_fd, fd;
+    long k;
+
+    memset(&server, 0, sizeof(Server));
+    while ((opt = getopt(argc, argv, "S:w:p:n:l:h")) != -1) {
+        switch (opt) {
+        case 'S':
+            socket_path = optarg;
+            break;
+        case 'w':
+            worker_ct = atol(optarg);
+            break;
+        case 'p':
+            target = strtoul(optarg, NULL, 10);
+            break;
+        case 'n':
+            sizes = optarg;
+            break;
+        case 'l':
+            server.time_budget_ms = strtoul(optarg, NULL, 10);
+            break;
+        case 'h':
+            print_usage(argv[0]);
+            return 0;
+        default:
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (worker_ct < 1)
+        worker_ct = 1;
+    if (strlen(socket_path) >= sizeof(address.sun_path)) {
+        report_error("socket path is too long");
+        return 1;
+    }
+
+    pthread_mutex_init(&server.lock, NULL);
+    pthread_cond_init(&server.work, NULL);
+    server.next_seed = time(NULL);
+    if (!server_warm(&server, sizes, target))
+        return 1;
+
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, socket_path);
+    listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(socket_path);
+    if (listen_fd < 0
+        || bind(listen_fd, (struct sockaddr *)&address, sizeof(address)) != 0
+        || listen(listen_fd, SOMAXCONN) != 0) {
+        report_system_error("failed to listen on the socket");
+        return 1;
+    }
+
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = stop;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+    action.sa_handler = SIG_IGN;
+    sigaction(SIGPIPE, &action, NULL);
+    /*
+     * Every thread inherits these blocked, so shutdown is only delivered
+     * while the main thread waits for a connection, which it interrupts.
+     */
+    sigemptyset(&shutdown_signals);
+    sigaddset(&shutdown_signals, SIGINT);
+    sigaddset(&shutdown_signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &shutdown_signals, &accept_mask);
+    sigdelset(&accept_mask, SIGINT);
+    sigdelset(&accept_mask, SIGTERM);
+
+    pthread_attr_init(&detached);
+    pthread_attr_setdetachstate(&detached, PTHREAD_CREATE_DETACHED);
+    for (k = 0; k < worker_ct; k++) {
+        if (pthread_create(&thread, &detached, server_worker_run, &server)
+            != 0) {
+            report_system_error("failed to start a generator thread");
+            return 1;
+        }
+    }
+
+    while (!stopping) {
+        FD_ZERO(&listen_set);
+        FD_SET(listen_fd, &listen_set);
+        if (pselect(listen_fd + 1, &listen_set, NULL, NULL, NULL, &accept_mask)
+            < 0) {
+            if (errno != EINTR)
+                report_system_error("failed to wait for a connection");
+            continue;
+        }
+        fd = accept(listen_fd, NULL, NULL);
+        if (fd < 0) {
+            report_system_error("failed to accept a connection");
+            continue;
+        }
+        connection = malloc(sizeof(Connection));
+        if (connection == NULL) {
+            close(fd);
+            continue;
+        }
+        connection->server = &server;
+        connection->fd = fd;
+        if (pthread_create(&thread, &detached, connection_run, connection)
+            != 0) {
+            close(fd);
+            free(connection);
+        }
+    }
+
+    /* threads still running die with the process */
+    close(listen_fd);
+    unlink(socket_path);
+    return 0;
+}
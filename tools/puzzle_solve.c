@@ -0,0 +1,541 @@
+#define _POSIX_C_SOURCE 200809L
+#include "binary_puzzle.h"
+#include "colors.h"
+#include "reporter.h"
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+/* puzzles a thread takes at a time, and writes out together */
+#define CHUNK_PUZZLES 1024
+#define MAX_SIZE 254
+
+/*
+ * Packed files hold puzzles of one size:
+ *
+ * 4 bytes  "BPZP"
+ * 1 byte   format version, PACKED_VERSION
+ * 1 byte   board size
+ * 2 bytes  zero
+ * per puzzle, `(size * size + 7) / 8` bytes of cell values then as many of
+ * given flags, row-major with the first cell in the top bit
+ */
+#define PACKED_MAGIC "BPZP"
+#define PACKED_VERSION 1
+#define PACKED_HEADER_SIZE 8
+
+typedef enum {
+    RESULT_UNIQUE,
+    RESULT_SOLVED,
+    RESULT_MULTIPLE,
+    RESULT_UNSOLVABLE,
+    RESULT_TOO_HARD,
+    RESULT_MALFORMED,
+    RESULT_ERROR,
+    RESULT_KIND_CT
+} result_kind_t;
+
+static const char *const result_names[] = {
+    "unique",    "solved",    "multiple", "unsolvable",
+    "too_hard",  "malformed", "error",
+};
+
+typedef struct {
+    const char *data;
+    size_t length;
+    bool packed;
+    /* packed files: side length and bytes per puzzle */
+    uint8_t size;
+    size_t record_size;
+    /* text files: offset of every non-blank line, plus one past the end */
+    size_t *line_offsets;
+    size_t puzzle_ct;
+
+    uint16_t allowed_guesses;
+    bool check_unique;
+
+    pthread_mutex_t lock;
+    /* signalled whenever a chunk has been written */
+    pthread_cond_t written;
+    size_t next_chunk;
+    size_t next_written_chunk;
+    size_t result_cts[RESULT_KIND_CT];
+    bool failed;
+} Solver;
+
+static void print_usage(const char *program) {
+    printf("usage: %s [-j threads] [-g guesses] [-q] [-c] file\n"
+           "\n"
+           "Solve every puzzle in `file`, either one per line as `binary_puzzle "
+           "-b`\n"
+           "prints them (blank lines and anything after the first space are "
+           "ignored) or\n"
+           "packed, and print `<status> <solution> <conflicts> <us>` for each, "
+           "in order.\n"
+           "Statuses are unique, ",
+           program);
+    printf("solved, multiple, unsolvable, too_hard (past the guess\n"
+           "limit), malformed and error; the solution is `-` when there is "
+           "none.\n"
+           "\n"
+           "  -j threads  solver threads (default one per CPU)\n"
+           "  -g guesses  nested guesses allowed per puzzle (default no "
+           "limit)\n"
+           "  -q          skip checking solutions are unique, reporting "
+           "`solved`\n"
+           "  -c          convert a text file to the packed format on stdout "
+           "instead\n");
+}
+
+/**
+ * Report an error in the puzzle file. Unlike `report_error`, this goes to
+ * stderr, since stdout carries the results or the packed file.
+ */
+static void report_file_error(const char *error) {
+    fprintf(stderr, RED "ERROR: " RESET "%s\n", error);
+}
+
+/**
+ * Set up `self` to read the `length` bytes at `data`.
+ *
+ * Return `true` iff successful.
+ */
+static bool solver_index(Solver *self, const char *data, size_t length) {
+    const unsigned char *header = (const unsigned char *)data;
+    const char *line, *end = data + length, *newline;
+    size_t capacity = 1024;
+    void *grown;
+
+    self->data = data;
+    self->length = length;
+    if (length >= PACKED_HEADER_SIZE
+        && memcmp(data, PACKED_MAGIC, strlen(PACKED_MAGIC)) == 0) {
+        if (header[4] != PACKED_VERSION || header[5] < 2
+            || header[5] % 2 != 0) {
+            report_file_error("unsupported packed file");
+            return false;
+        }
+        self->packed = true;
+        self->size = header[5];
+        self->record_size = 2 * (((size_t)self->size * self->size + 7) / 8);
+        self->puzzle_ct = (length - PACKED_HEADER_SIZE) / self->record_size;
+        return true;
+    }
+
+    self->line_offsets = malloc(capacity * sizeof(size_t));
+    if (self->line_offsets == NULL)
+        return false;
+    for (line = data; line < end; line = newline + 1) {
+        newline = memchr(line, '\n', end - line);
+        if (newline == NULL)
+            newline = end;
+        /* blank lines hold no puzzle */
+        if (newline == line || (newline == line + 1 && *line == '\r'))
+            continue;
+        if (self->puzzle_ct + 1 == capacity) {
+            capacity *= 2;
+            grown = realloc(self->line_offsets, capacity * sizeof(size_t));
+            if (grown == NULL)
+                return false;
+            self->line_offsets = grown;
+        }
+        self->line_offsets[self->puzzle_ct++] = line - data;
+    }
+    self->line_offsets[self->puzzle_ct] = length + 1;
+    return true;
+}
+
+/**
+ * Copy the cells of puzzle `k` into `cells`, null terminated, and set `size`
+ * to its side length.
+ *
+ * Return `false` if the puzzle is malformed.
+ */
+static bool solver_read(const Solver *self, size_t k, char *cells,
+                        uint8_t *size) {
+    const unsigned char *record;
+    const char *line;
+    size_t cell_ct, half, l, side;
+
+    if (self->packed) {
+        record = (const unsigned char *)self->data + PACKED_HEADER_SIZE
+                 + k * self->record_size;
+        cell_ct = (size_t)self->size * self->size;
+        half = self->record_size / 2;
+        for (l = 0; l < cell_ct; l++) {
+            if (!(record[half + l / 8] & 0x80 >> l % 8)) {
+                cells[l] = '.';
+            } else {
+                cells[l] = record[l / 8] & 0x80 >> l % 8 ? '1' : '0';
+            }
+        }
+        cells[cell_ct] = '\0';
+        *size = self->size;
+        return true;
+    }
+
+    line = self->data + self->line_offsets[k];
+    /* the next puzzle's offset, or one past the end of the file, bounds it */
+    cell_ct = self->line_offsets[k + 1] - 1 - self->line_offsets[k];
+    for (l = 0; l < cell_ct; l++) {
+        if (line[l] == ' ' || line[l] == '\r' || line[l] == '\n')
+            break;
+    }
+    cell_ct = l;
+    for (side = 2; side * side < cell_ct && side < MAX_SIZE; side += 2)
+        ;
+    if (side * side != cell_ct)
+        return false;
+    memcpy(cells, line, cell_ct);
+    cells[cell_ct] = '\0';
+    *size = side;
+    return true;
+}
+
+static uint64_t elapsed_us(const struct timespec *start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)(now.tv_sec - start->tv_sec) * 1000000
+           + (now.tv_nsec - start->tv_nsec) / 1000;
+}
+
+/**
+ * Solve puzzle `k`, writing its result line to `out`.
+ */
+static result_kind_t solver_solve(const Solver *self, size_t k, char *cells,
+                                  FILE *out) {
+    BinaryPuzzle *puzzle = NULL;
+    binary_puzzle_stats_t stats;
+    binary_puzzle_status_t status;
+    struct timespec start;
+    result_kind_t kind;
+    uint64_t us;
+    uint8_t size;
+    bool unique = true;
+
+    if (!solver_read(self, k, cells, &size)) {
+        fprintf(out, "%s - 0 0\n", result_names[RESULT_MALFORMED]);
+        return RESULT_MALFORMED;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    status = binary_puzzle_parse(size, cells, &puzzle);
+    if (status == BINARY_PUZZLE_OK)
+        status = binary_puzzle_solve(puzzle, self->allowed_guesses);
+    if (status == BINARY_PUZZLE_OK && self->check_unique)
+        status = binary_puzzle_check_unique(puzzle, &unique);
+    us = elapsed_us(&start);
+
+    switch (status) {
+    case BINARY_PUZZLE_OK:
+        kind = !self->check_unique ? RESULT_SOLVED
+               : unique            ? RESULT_UNIQUE
+                                   : RESULT_MULTIPLE;
+        break;
+    case BINARY_PUZZLE_ERR_UNSOLVABLE:
+        kind = RESULT_UNSOLVABLE;
+        break;
+    case BINARY_PUZZLE_ERR_OUT_OF_GUESSES:
+        kind = RESULT_TOO_HARD;
+        break;
+    case BINARY_PUZZLE_ERR_INVALID_ARGUMENT:
+        kind = RESULT_MALFORMED;
+        break;
+    default:
+        kind = RESULT_ERROR;
+        break;
+    }
+
+    if (kind == RESULT_UNIQUE || kind == RESULT_SOLVED
+        || kind == RESULT_MULTIPLE) {
+        binary_puzzle_write_cells(puzzle, true, cells);
+    } else {
+        strcpy(cells, "-");
+    }
+    stats.conflicts = 0;
+    if (puzzle != NULL)
+        binary_puzzle_get_stats(puzzle, &stats);
+    fprintf(out, "%s %s %lu %lu\n", result_names[kind], cells,
+            (unsigned long)stats.conflicts, (unsigned long)us);
+    binary_puzzle_destroy(puzzle);
+    return kind;
+}
+
+/**
+ * Mark the run of `self` failed, passing the turn of `chunk` on to the next
+ * chunk once every earlier one is out, so no other thread waits on it.
+ */
+static void solver_fail_chunk(Solver *self, size_t chunk) {
+    pthread_mutex_lock(&self->lock);
+    while (self->next_written_chunk != chunk) {
+        pthread_cond_wait(&self->written, &self->lock);
+    }
+    self->failed = true;
+    self->next_written_chunk++;
+    pthread_cond_broadcast(&self->written);
+    pthread_mutex_unlock(&self->lock);
+}
+
+/**
+ * Solve chunks of puzzles until none are left, writing each chunk's results
+ * to stdout once those of every earlier chunk are out.
+ */
+static void *solver_run(void *arg) {
+    Solver *self = arg;
+    size_t result_cts[RESULT_KIND_CT];
+    size_t chunk, k, end, kind;
+    char *buffer = NULL;
+    size_t buffer_size = 0;
+    char *cells = malloc((size_t)MAX_SIZE * MAX_SIZE + 2);
+    FILE *out;
+    bool written;
+
+    if (cells == NULL) {
+        pthread_mutex_lock(&self->lock);
+        self->failed = true;
+        pthread_mutex_unlock(&self->lock);
+        return NULL;
+    }
+    for (;;) {
+        pthread_mutex_lock(&self->lock);
+        chunk = self->next_chunk++;
+        pthread_mutex_unlock(&self->lock);
+        if (chunk * CHUNK_PUZZLES >= self->puzzle_ct)
+            break;
+
+        out = open_memstream(&buffer, &buffer_size);
+        if (out == NULL) {
+            solver_fail_chunk(self, chunk);
+            break;
+        }
+        memset(result_cts, 0, sizeof(result_cts));
+        end = (chunk + 1) * CHUNK_PUZZLES;
+        if (end > self->puzzle_ct)
+            end = self->puzzle_ct;
+        for (k = chunk * CHUNK_PUZZLES; k < end; k++) {
+            result_cts[solver_solve(self, k, cells, out)]++;
+        }
+        written = !ferror(out);
+        if (fclose(out) != 0 || !written) {
+            free(buffer);
+            buffer = NULL;
+            solver_fail_chunk(self, chunk);
+            break;
+        }
+
+        /* keep the output in input order */
+        pthread_mutex_lock(&self->lock);
+        while (self->next_written_chunk != chunk) {
+            pthread_cond_wait(&self->written, &self->lock);
+        }
+        if (fwrite(buffer, 1, buffer_size, stdout) != buffer_size)
+            self->failed = true;
+        for (kind = 0; kind < RESULT_KIND_CT; kind++) {
+            self->result_cts[kind] += result_cts[kind];
+        }
+        self->next_written_chunk++;
+        pthread_cond_broadcast(&self->written);
+        pthread_mutex_unlock(&self->lock);
+        free(buffer);
+        buffer = NULL;
+    }
+    free(cells);
+    return NULL;
+}
+
+/**
+ * Write the puzzles of the text file in `self` to stdout in the packed
+ * format. The file is built in memory first, so nothing is written unless
+ * every puzzle converts.
+ *
+ * Return `true` iff successful.
+ */
+static bool solver_convert(const Solver *self) {
+    unsigned char header[PACKED_HEADER_SIZE] = {0};
+    unsigned char *record = NULL;
+    char *cells = malloc((size_t)MAX_SIZE * MAX_SIZE + 2);
+    char *buffer = NULL;
+    size_t buffer_size = 0;
+    size_t k, l, half = 0, cell_ct = 0;
+    uint8_t size, first_size = 0;
+    FILE *out = open_memstream(&buffer, &buffer_size);
+    bool ok = cells != NULL && out != NULL;
+
+    if (!ok)
+        report_system_error("memory allocation failure");
+    for (k = 0; ok && k < self->puzzle_ct; k++) {
+        if (!solver_read(self, k, cells, &size)) {
+            report_file_error("malformed puzzle");
+            ok = false;
+            break;
+        }
+        if (k == 0) {
+            first_size = size;
+            cell_ct = (size_t)size * size;
+            half = (cell_ct + 7) / 8;
+            record = malloc(2 * half);
+            memcpy(header, PACKED_MAGIC, strlen(PACKED_MAGIC));
+            header[4] = PACKED_VERSION;
+            header[5] = size;
+            ok = record != NULL && fwrite(header, sizeof(header), 1, out) == 1;
+            if (!ok)
+                report_system_error("memory allocation failure");
+        } else if (size != first_size) {
+            report_file_error("packed files hold puzzles of one size");
+            ok = false;
+        }
+        if (!ok)
+            break;
+        memset(record, 0, 2 * half);
+        for (l = 0; l < cell_ct; l++) {
+            if (cells[l] == '0' || cells[l] == '1') {
+                record[half + l / 8] |= 0x80 >> l % 8;
+                if (cells[l] == '1')
+                    record[l / 8] |= 0x80 >> l % 8;
+            }
+        }
+        ok = fwrite(record, 2 * half, 1, out) == 1;
+        if (!ok)
+            report_system_error("memory allocation failure");
+    }
+    if (out != NULL && fclose(out) != 0 && ok) {
+        report_system_error("memory allocation failure");
+        ok = false;
+    }
+    if (ok && fwrite(buffer, 1, buffer_size, stdout) != buffer_size) {
+        report_system_error("failed to write the packed file");
+        ok = false;
+    }
+    free(buffer);
+    free(cells);
+    free(record);
+    return ok;
+}
+
+int main(int argc, char **argv) {
+    Solver solver;
+    pthread_t *threads = NULL;
+    struct stat file_stat;
+    struct timespec start;
+    void *data = MAP_FAILED;
+    long thread_ct = sysconf(_SC_NPROCESSORS_ONLN), k, started_ct = 0;
+    unsigned long guesses;
+    bool convert = false;
+    int opt, fd, exit_code = 0;
+    size_t kind;
+    double seconds;
+
+    memset(&solver, 0, sizeof(Solver));
+    solver.allowed_guesses = UINT16_MAX;
+    solver.check_unique = true;
+    while ((opt = getopt(argc, argv, "j:g:qch")) != -1) {
+        switch (opt) {
+        case 'j':
+            thread_ct = atol(optarg);
+            break;
+        case 'g':
+            guesses = strtoul(optarg, NULL, 10);
+            solver.allowed_guesses
+                = guesses < UINT16_MAX ? guesses : UINT16_MAX;
+            break;
+        case 'q':
+            solver.check_unique = false;
+            break;
+        case 'c':
+            convert = true;
+            break;
+        case 'h':
+            print_usage(argv[0]);
+            return 0;
+        default:
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (optind != argc - 1) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    if (thread_ct < 1)
+        thread_ct = 1;
+
+    fd = open(argv[optind], O_RDONLY);
+    if (fd < 0 || fstat(fd, &file_stat) != 0) {
+        report_system_error("failed to open the puzzle file");
+        return 1;
+    }
+    if (file_stat.st_size > 0) {
+        data = mmap(NULL, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            report_system_error("failed to map the puzzle file");
+            close(fd);
+            return 1;
+        }
+    }
+    close(fd);
+
+    if (!solver_index(&solver, data == MAP_FAILED ? "" : data,
+                      file_stat.st_size)) {
+        exit_code = 1;
+        goto main_done;
+    }
+    if (convert) {
+        if (solver.packed) {
+            report_file_error("the file is packed already");
+            exit_code = 1;
+        } else if (!solver_convert(&solver)) {
+            exit_code = 1;
+        }
+        goto main_done;
+    }
+    pthread_mutex_init(&solver.lock, NULL);
+    pthread_cond_init(&solver.written, NULL);
+    threads = malloc(thread_ct * sizeof(pthread_t));
+    if (threads == NULL) {
+        report_system_error("memory allocation failure");
+        exit_code = 1;
+        goto main_done;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (k = 0; k < thread_ct; k++) {
+        if (pthread_create(&threads[k], NULL, solver_run, &solver) != 0)
+            break;
+        started_ct++;
+    }
+    if (started_ct == 0) {
+        solver_run(&solver);
+    }
+    for (k = 0; k < started_ct; k++) {
+        pthread_join(threads[k], NULL);
+    }
+    seconds = elapsed_us(&start) / 1e6;
+    if (fflush(stdout) != 0 || solver.failed) {
+        report_system_error("failed to write results");
+        exit_code = 1;
+    }
+
+    fprintf(stderr, "%lu puzzles in %.2f s (%.0f/s):",
+            (unsigned long)solver.puzzle_ct, seconds,
+            seconds > 0 ? solver.puzzle_ct / seconds : 0);
+    for (kind = 0; kind < RESULT_KIND_CT; kind++) {
+        fprintf(stderr, " %lu %s", (unsigned long)solver.result_cts[kind],
+                result_names[kind]);
+    }
+    fprintf(stderr, "\n");
+    if (solver.result_cts[RESULT_MALFORMED] > 0
+        || solver.result_cts[RESULT_ERROR] > 0)
+        exit_code = 1;
+
+main_done:
+    if (data != MAP_FAILED)
+        munmap(data, file_stat.st_size);
+    free(solver.line_offsets);
+    free(threads);
+    return exit_code;
+}
@@ -0,0 +1,262 @@
+#define _POSIX_C_SOURCE 200809L
+#include "binary_puzzle.h"
+#include "colors.h"
+#include "reporter.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define FRAME_DELAY_MS 20
+
+/* cell values of the board being replayed */
+#define CELL_UNKNOWN (-1)
+
+typedef struct {
+    uint8_t size;
+    signed char *cells;
+    bool *hidden;
+    /* board before each guess still open, `size * size` cells apiece */
+    signed char *snapshots;
+    uint8_t *guess_i;
+    uint8_t *guess_j;
+    size_t guess_ct;
+    size_t guess_capacity;
+} Replay;
+
+static void print_usage(const char *program) {
+    printf("usage: %s [-d ms] [-s scale] trace\n"
+           "\n"
+           "Animate a trace recorded by `binary_puzzle -t trace`.\n"
+           "\n"
+           "  -d ms     pause after every event (default %d)\n"
+           "  -s scale  also pause `scale` times the recorded time between\n"
+           "            events (default 0)\n",
+           program, FRAME_DELAY_MS);
+}
+
+/**
+ * Remember the board before a guess at cell (i, j).
+ *
+ * Return `true` iff successful.
+ */
+static bool replay_push_guess(Replay *self, uint8_t i, uint8_t j) {
+    const size_t cell_ct = (size_t)self->size * self->size;
+    size_t capacity;
+    void *grown;
+
+    if (self->guess_ct == self->guess_capacity) {
+        capacity = self->guess_capacity == 0 ? 16 : 2 * self->guess_capacity;
+        if ((grown = realloc(self->snapshots, capacity * cell_ct)) == NULL)
+            return false;
+        self->snapshots = grown;
+        if ((grown = realloc(self->guess_i, capacity)) == NULL)
+            return false;
+        self->guess_i = grown;
+        if ((grown = realloc(self->guess_j, capacity)) == NULL)
+            return false;
+        self->guess_j = grown;
+        self->guess_capacity = capacity;
+    }
+    memcpy(self->snapshots + self->guess_ct * cell_ct, self->cells, cell_ct);
+    self->guess_i[self->guess_ct] = i;
+    self->guess_j[self->guess_ct] = j;
+    self->guess_ct++;
+    return true;
+}
+
+/**
+ * Restore the board to before the latest guess at cell (i, j), discarding
+ * the guesses made after it.
+ */
+static void replay_backtrack(Replay *self, uint8_t i, uint8_t j) {
+    const size_t cell_ct = (size_t)self->size * self->size;
+    while (self->guess_ct > 0) {
+        if (self->guess_i[self->guess_ct - 1] == i
+            && self->guess_j[self->guess_ct - 1] == j) {
+            memcpy(self->cells, self->snapshots + (self->guess_ct - 1) * cell_ct,
+                   cell_ct);
+            return;
+        }
+        self->guess_ct--;
+    }
+}
+
+/**
+ * Apply `event` to the board.
+ *
+ * Return `true` iff successful.
+ */
+static bool replay_apply(Replay *self, const binary_puzzle_event_t *event) {
+    const size_t cell = (size_t)event->i * self->size + event->j;
+    switch (event->kind) {
+    case BINARY_PUZZLE_EVENT_GUESS:
+        if (!replay_push_guess(self, event->i, event->j))
+            return false;
+        self->cells[cell] = event->value;
+        break;
+    case BINARY_PUZZLE_EVENT_BACKTRACK:
+        replay_backtrack(self, event->i, event->j);
+        self->cells[cell] = event->value;
+        break;
+    case BINARY_PUZZLE_EVENT_ASSIGN:
+        self->cells[cell] = event->value;
+        break;
+    case BINARY_PUZZLE_EVENT_RESTART:
+        memset(self->cells, CELL_UNKNOWN, (size_t)self->size * self->size);
+        self->guess_ct = 0;
+        break;
+    case BINARY_PUZZLE_EVENT_MASK_ACCEPT:
+        self->hidden[cell] = true;
+        break;
+    default:
+        break;
+    }
+    return true;
+}
+
+static const char *event_name(uint8_t kind) {
+    switch (kind) {
+    case BINARY_PUZZLE_EVENT_ASSIGN:
+        return "assign";
+    case BINARY_PUZZLE_EVENT_GUESS:
+        return "guess";
+    case BINARY_PUZZLE_EVENT_BACKTRACK:
+        return "backtrack";
+    case BINARY_PUZZLE_EVENT_RESTART:
+        return "restart";
+    case BINARY_PUZZLE_EVENT_MASK_ACCEPT:
+        return "hide";
+    case BINARY_PUZZLE_EVENT_MASK_REJECT:
+        return "keep";
+    }
+    return "unknown";
+}
+
+/**
+ * Draw the board, highlighting the cell `event` is about.
+ */
+static void replay_print_frame(const Replay *self,
+                               const binary_puzzle_event_t *event, size_t k,
+                               size_t event_ct) {
+    const char *highlight = event->kind == BINARY_PUZZLE_EVENT_GUESS ? YELLOW
+                            : event->kind == BINARY_PUZZLE_EVENT_BACKTRACK
+                                ? ORANGE
+                            : event->kind == BINARY_PUZZLE_EVENT_MASK_REJECT
+                                ? PURPLE
+                                : NULL;
+    size_t i, j, cell;
+
+    printf(CLEAR_SCREEN RESET_CURSOR);
+    for (i = 0; i < self->size; i++) {
+        for (j = 0; j < self->size; j++) {
+            cell = i * self->size + j;
+            if (highlight != NULL && i == event->i && j == event->j) {
+                printf("%s%d " RESET, highlight, self->cells[cell]);
+            } else if (self->hidden[cell]) {
+                printf(BLUE "? " RESET);
+            } else if (self->cells[cell] == CELL_UNKNOWN) {
+                printf(RED "X " RESET);
+            } else {
+                printf(GREEN "%d " RESET, self->cells[cell]);
+            }
+        }
+        printf("\n");
+    }
+    printf("%lu/%lu %s (%lu, %lu) at %lu us\n", (unsigned long)k + 1,
+           (unsigned long)event_ct, event_name(event->kind),
+           (unsigned long)event->i, (unsigned long)event->j,
+           (unsigned long)event->time_us);
+    fflush(stdout);
+}
+
+static void sleep_us(unsigned long us) {
+    struct timespec delay;
+    delay.tv_sec = us / 1000000;
+    delay.tv_nsec = (long)(us % 1000000) * 1000;
+    nanosleep(&delay, NULL);
+}
+
+int main(int argc, char **argv) {
+    BinaryPuzzleTrace *trace;
+    binary_puzzle_status_t status;
+    binary_puzzle_event_t event;
+    Replay replay;
+    size_t k, event_ct, cell_ct;
+    unsigned long delay_ms = FRAME_DELAY_MS, scale = 0;
+    uint64_t last_time_us = 0;
+    int opt, exit_code = 0;
+
+    while ((opt = getopt(argc, argv, "d:s:h")) != -1) {
+        switch (opt) {
+        case 'd':
+            delay_ms = strtoul(optarg, NULL, 10);
+            break;
+        case 's':
+            scale = strtoul(optarg, NULL, 10);
+            break;
+        case 'h':
+            print_usage(argv[0]);
+            return 0;
+        default:
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (optind != argc - 1) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    status = binary_puzzle_trace_load(argv[optind], &trace);
+    if (status != BINARY_PUZZLE_OK) {
+        report_system_error(binary_puzzle_status_string(status));
+        return 1;
+    }
+    event_ct = binary_puzzle_trace_get_event_count(trace);
+
+    memset(&replay, 0, sizeof(Replay));
+    replay.size = binary_puzzle_trace_get_size(trace);
+    cell_ct = (size_t)replay.size * replay.size;
+    replay.cells = malloc(cell_ct);
+    replay.hidden = calloc(cell_ct, sizeof(bool));
+    if (replay.cells == NULL || replay.hidden == NULL) {
+        report_system_error("memory allocation failure");
+        exit_code = 1;
+        goto main_done;
+    }
+    memset(replay.cells, CELL_UNKNOWN, cell_ct);
+
+    for (k = 0; k < event_ct; k++) {
+        event = binary_puzzle_trace_get_event(trace, k);
+        if (event.i >= replay.size || event.j >= replay.size) {
+            report_error("trace refers to cells off the board");
+            exit_code = 1;
+            break;
+        }
+        if (!replay_apply(&replay, &event)) {
+            report_system_error("memory allocation failure");
+            exit_code = 1;
+            break;
+        }
+        replay_print_frame(&replay, &event, k, event_ct);
+        if (k > 0) {
+            sleep_us(delay_ms * 1000 + (event.time_us - last_time_us) * scale);
+        }
+        last_time_us = event.time_us;
+    }
+    if (binary_puzzle_trace_get_dropped_count(trace) > 0) {
+        report_warning("the ring buffer overflowed, so the replay starts "
+                       "partway through");
+    }
+
+main_done:
+    free(replay.cells);
+    free(replay.hidden);
+    free(replay.snapshots);
+    free(replay.guess_i);
+    free(replay.guess_j);
+    binary_puzzle_trace_destroy(trace);
+    return exit_code;
+}
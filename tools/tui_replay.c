@@ -0,0 +1,256 @@
+#define _XOPEN_SOURCE 700
+#include "reporter.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define ROW_CT 50
+#define COL_CT 200
+#define KEY_INTERVAL_MS 20
+#define START_DELAY_MS 100
+/* how long the program gets to exit once the script is typed */
+#define EXIT_TIMEOUT_MS 5000
+
+static void print_usage(const char *program) {
+    printf("usage: %s [-r rows] [-c cols] [-i ms] [-w ms] script -- program "
+           "[args]\n"
+           "\n"
+           "Run `program` on a new pseudo-terminal and type every byte of "
+           "`script` into\n"
+           "it as one key, starting once it first draws. Its output is read "
+           "and dropped.\n"
+           "Exits with the program's status, so `binary_puzzle -k file` "
+           "can be timed\n"
+           "without a keyboard.\n"
+           "\n",
+           program);
+    printf("  -r rows  terminal height (default %d)\n"
+           "  -c cols  terminal width (default %d)\n"
+           "  -i ms    pause between keys (default %d)\n"
+           "  -w ms    pause between the first output and the first key "
+           "(default %d)\n",
+           ROW_CT, COL_CT, KEY_INTERVAL_MS, START_DELAY_MS);
+}
+
+static long elapsed_ms(const struct timespec *start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) * 1000
+           + (now.tv_nsec - start->tv_nsec) / 1000000;
+}
+
+/**
+ * Read and drop the output on `master` for `timeout_ms` milliseconds, or
+ * until output has arrived if `timeout_ms` is negative, adding to
+ * `byte_ct`.
+ *
+ * Return `false` once the program has closed the terminal.
+ */
+static bool drain(int master, long timeout_ms, unsigned long *byte_ct) {
+    char buffer[1 << 16];
+    struct pollfd poll_fd;
+    struct timespec start;
+    long remaining_ms = timeout_ms;
+    ssize_t read_ct;
+    int ready;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    poll_fd.fd = master;
+    poll_fd.events = POLLIN;
+    for (;;) {
+        if (timeout_ms >= 0) {
+            remaining_ms = timeout_ms - elapsed_ms(&start);
+            if (remaining_ms < 0)
+                return true;
+        }
+        ready = poll(&poll_fd, 1, remaining_ms);
+        if (ready < 0 && errno != EINTR)
+            return false;
+        if (ready <= 0)
+            continue;
+        read_ct = read(master, buffer, sizeof(buffer));
+        /* Linux answers reads with `EIO` once the other side is closed */
+        if (read_ct < 0 && errno != EINTR && errno != EAGAIN)
+            return false;
+        if (read_ct == 0)
+            return false;
+        if (read_ct > 0) {
+            *byte_ct += read_ct;
+            if (timeout_ms < 0)
+                return true;
+        }
+    }
+}
+
+/**
+ * Read the whole file at `path` into `out`, setting `len` to its length.
+ *
+ * Return `true` iff successful.
+ */
+static bool read_script(const char *path, char **out, size_t *len) {
+    FILE *in = fopen(path, "rb");
+    size_t size = 4096, read_ct;
+    char *script = malloc(size), *grown;
+
+    *len = 0;
+    if (in == NULL || script == NULL) {
+        free(script);
+        if (in != NULL)
+            fclose(in);
+        return false;
+    }
+    while ((read_ct = fread(script + *len, 1, size - *len, in)) > 0) {
+        *len += read_ct;
+        if (*len == size) {
+            grown = realloc(script, size *= 2);
+            if (grown == NULL) {
+                free(script);
+                fclose(in);
+                return false;
+            }
+            script = grown;
+        }
+    }
+    if (ferror(in)) {
+        free(script);
+        fclose(in);
+        return false;
+    }
+    fclose(in);
+    *out = script;
+    return true;
+}
+
+/**
+ * Start `argv` with a new pseudo-terminal of `rows` by `cols` as its
+ * controlling terminal, setting `master` to the other side.
+ *
+ * Return the child's pid, or -1 on failure.
+ */
+static pid_t spawn_on_terminal(char **argv, unsigned short rows,
+                               unsigned short cols, int *master) {
+    struct winsize ws;
+    char *slave_name;
+    pid_t pid;
+    int slave;
+
+    *master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (*master < 0 || grantpt(*master) != 0 || unlockpt(*master) != 0
+        || (slave_name = ptsname(*master)) == NULL) {
+        return -1;
+    }
+    memset(&ws, 0, sizeof(ws));
+    ws.ws_row = rows;
+    ws.ws_col = cols;
+    if (ioctl(*master, TIOCSWINSZ, &ws) != 0)
+        return -1;
+
+    pid = fork();
+    if (pid != 0)
+        return pid;
+    /* a new session takes the first terminal it opens as its own */
+    setsid();
+    slave = open(slave_name, O_RDWR);
+    if (slave < 0)
+        _exit(127);
+    dup2(slave, STDIN_FILENO);
+    dup2(slave, STDOUT_FILENO);
+    dup2(slave, STDERR_FILENO);
+    if (slave > STDERR_FILENO)
+        close(slave);
+    close(*master);
+    execvp(argv[0], argv);
+    _exit(127);
+    return -1;
+}
+
+int main(int argc, char **argv) {
+    long interval_ms = KEY_INTERVAL_MS, start_delay_ms = START_DELAY_MS;
+    int opt, rows = ROW_CT, cols = COL_CT, master = -1, wait_status;
+    unsigned long byte_ct = 0;
+    struct timespec start;
+    char *script;
+    size_t script_len, k;
+    bool running;
+    pid_t pid;
+
+    while ((opt = getopt(argc, argv, "r:c:i:w:h")) != -1) {
+        switch (opt) {
+        case 'r':
+            rows = atoi(optarg);
+            break;
+        case 'c':
+            cols = atoi(optarg);
+            break;
+        case 'i':
+            interval_ms = atol(optarg);
+            break;
+        case 'w':
+            start_delay_ms = atol(optarg);
+            break;
+        case 'h':
+            print_usage(argv[0]);
+            return 0;
+        default:
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (argc - optind < 2) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    if (rows <= 0 || rows > 9999 || cols <= 0 || cols > 9999
+        || interval_ms < 0 || start_delay_ms < 0) {
+        report_error("rows and columns must be between 1 and 9999, pauses "
+                     "at least 0");
+        return 1;
+    }
+    if (!read_script(argv[optind], &script, &script_len)) {
+        report_system_error("failed to read script");
+        return 1;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    pid = spawn_on_terminal(&argv[optind + 1], rows, cols, &master);
+    if (pid < 0) {
+        report_system_error("failed to start program on a pseudo-terminal");
+        free(script);
+        if (master >= 0)
+            close(master);
+        return 1;
+    }
+
+    running = drain(master, -1, &byte_ct)
+              && drain(master, start_delay_ms, &byte_ct);
+    for (k = 0; k < script_len && running; k++) {
+        if (write(master, &script[k], 1) != 1)
+            break;
+        running = drain(master, interval_ms, &byte_ct);
+    }
+    if (running)
+        running = drain(master, EXIT_TIMEOUT_MS, &byte_ct);
+    if (running) {
+        report_error("program still running after the script");
+        kill(pid, SIGKILL);
+    }
+    waitpid(pid, &wait_status, 0);
+    printf("typed %lu of %lu keys, read %lu bytes in %.3f s\n",
+           (unsigned long)k, (unsigned long)script_len, byte_ct,
+           elapsed_ms(&start) / 1000.0);
+
+    close(master);
+    free(script);
+    if (running || !WIFEXITED(wait_status))
+        return 1;
+    return WEXITSTATUS(wait_status);
+}